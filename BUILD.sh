@@ -1 +1,2 @@
 make
+make -f Makefile.batch
@@ -0,0 +1,23 @@
+#! /bin/sh
+# Renders the same frames one at a time and in batches, and checks that the
+# images are identical. Extra arguments (effects, --width...) are passed to
+# both renders.
+
+DIR=`mktemp -d`
+cd ./bin || exit 1
+
+./raymarcher-batch --first 0 --last 11 --batch 0 --output "$DIR/single" "$@" > /dev/null || exit 1
+./raymarcher-batch --first 0 --last 11 --batch 5 --output "$DIR/batched" "$@" > /dev/null || exit 1
+
+STATUS=0
+for f in "$DIR"/single*.ppm
+do
+    if ! cmp -s "$f" "$DIR/batched${f#$DIR/single}"
+    then
+        echo "-- `basename $f` differs"
+        STATUS=1
+    fi
+done
+rm -r "$DIR"
+[ $STATUS = 0 ] && echo "-- batched frames match"
+exit $STATUS
@@ -8,11 +8,21 @@ HEADERS +=  src/io/Window.hpp \
             src/renderer/FrameBuffer.hpp \
             src/renderer/Shader.hpp \
             src/renderer/DrawQuad.hpp \
+            src/renderer/NodeSchedule.hpp \
+            src/renderer/Profiler.hpp \
+            src/renderer/FrameData.hpp \
+            src/renderer/ShaderCache.hpp \
+            src/renderer/RenderTargetPool.hpp \
+            src/renderer/TextureFormat.hpp \
+            src/renderer/RenderSize.hpp \
+            src/renderer/Pipeline.hpp \
             src/nodes/TimeNode.hpp \
             src/nodes/ColorNode.hpp \
             src/nodes/RayMarchingNode.hpp \
             src/nodes/FloatMathNodes.hpp \
             src/nodes/ColorMix.hpp \
+            src/nodes/BloomNode.hpp \
+            src/nodes/DofNode.hpp \
             src/utils/CheckGLError.hpp \
     src/io/NodeView.hpp \
     src/io/Compositor.hpp \
@@ -26,7 +36,8 @@ HEADERS +=  src/io/Window.hpp \
     src/io/SliderNodeView.hpp \
     src/io/SliderNodeAdapter.hpp \
     src/io/ColourPicker.hpp \
-    src/io/CreateNodeAction.hpp
+    src/io/CreateNodeAction.hpp \
+    src/io/NodeMenu.hpp
 
 INCLUDEPATH += ./extern ./src ./extern/kiwi/include
 SOURCES +=  src/main.cpp \
@@ -36,11 +47,20 @@ SOURCES +=  src/main.cpp \
             src/renderer/Shader.cpp \
             src/renderer/FrameBuffer.cpp \
             src/renderer/DrawQuad.cpp \
+            src/renderer/NodeSchedule.cpp \
+            src/renderer/Profiler.cpp \
+            src/renderer/FrameData.cpp \
+            src/renderer/ShaderCache.cpp \
+            src/renderer/RenderTargetPool.cpp \
+            src/renderer/RenderSize.cpp \
+            src/renderer/Pipeline.cpp \
             src/nodes/TimeNode.cpp \
             src/nodes/ColorNode.cpp \
             src/nodes/RayMarchingNode.cpp \
             src/nodes/FloatMathNodes.cpp \
             src/nodes/ColorMix.cpp \
+            src/nodes/BloomNode.cpp \
+            src/nodes/DofNode.cpp \
             src/utils/CheckGLError.cpp \
             src/KiwiInit.cpp \
     src/io/NodeView.cpp \
@@ -55,9 +75,13 @@ SOURCES +=  src/main.cpp \
     src/io/SliderNodeView.cpp \
     src/io/SliderNodeAdapter.cpp \
     src/io/ColourPicker.cpp \
-    src/io/CreateNodeAction.cpp
+    src/io/CreateNodeAction.cpp \
+    src/io/NodeMenu.cpp
 
 QMAKE_CXXFLAGS += -std=c++0x -pg -g
+
+# GL error checking: 0 = off, 1 = glGetError at each CHECKERROR, 2 = KHR_debug callback
+CONFIG(release, debug|release): DEFINES += GL_CHECK_MODE=0
             
 LIBS += -lGLEW ./extern/kiwi/libkiwicpp.a
 DESTDIR = ./bin/
@@ -1 +1,2 @@
 qmake -o Makefile GLSLraymarcher.pro
+qmake -o Makefile.batch raymarcher-batch.pro
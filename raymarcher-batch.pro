@@ -0,0 +1,70 @@
+# Headless renderer: no Qt, renders through an EGL surfaceless context.
+TEMPLATE = app
+CONFIG -= qt
+CONFIG += console
+HEADERS +=  src/batch/HeadlessContext.hpp \
+            src/batch/FrameReadback.hpp \
+            src/utils/LoadFile.hpp \
+            src/utils/SaveImage.hpp \
+            src/utils/CheckGLError.hpp \
+            src/renderer/Texture.hpp \
+            src/renderer/FrameBuffer.hpp \
+            src/renderer/Shader.hpp \
+            src/renderer/DrawQuad.hpp \
+            src/renderer/NodeSchedule.hpp \
+            src/renderer/Profiler.hpp \
+            src/renderer/FrameData.hpp \
+            src/renderer/ShaderCache.hpp \
+            src/renderer/RenderTargetPool.hpp \
+            src/renderer/TextureFormat.hpp \
+            src/renderer/RenderSize.hpp \
+            src/renderer/Pipeline.hpp \
+            src/nodes/TimeNode.hpp \
+            src/nodes/ColorNode.hpp \
+            src/nodes/RayMarchingNode.hpp \
+            src/nodes/FloatMathNodes.hpp \
+            src/nodes/ColorMix.hpp \
+            src/nodes/PostFxNode.hpp \
+            src/nodes/BloomNode.hpp \
+            src/nodes/DofNode.hpp \
+            src/cpu/Packet.hpp \
+            src/cpu/RayMarcher.hpp \
+            src/cpu/TileScheduler.hpp
+
+INCLUDEPATH += ./extern ./src ./extern/kiwi/include
+SOURCES +=  src/batch/main.cpp \
+            src/batch/HeadlessContext.cpp \
+            src/batch/FrameReadback.cpp \
+            src/KiwiInit.cpp \
+            src/utils/LoadFile.cpp \
+            src/utils/SaveImage.cpp \
+            src/utils/CheckGLError.cpp \
+            src/renderer/Shader.cpp \
+            src/renderer/FrameBuffer.cpp \
+            src/renderer/DrawQuad.cpp \
+            src/renderer/NodeSchedule.cpp \
+            src/renderer/Profiler.cpp \
+            src/renderer/FrameData.cpp \
+            src/renderer/ShaderCache.cpp \
+            src/renderer/RenderTargetPool.cpp \
+            src/renderer/RenderSize.cpp \
+            src/renderer/Pipeline.cpp \
+            src/nodes/TimeNode.cpp \
+            src/nodes/ColorNode.cpp \
+            src/nodes/RayMarchingNode.cpp \
+            src/nodes/FloatMathNodes.cpp \
+            src/nodes/ColorMix.cpp \
+            src/nodes/PostFxNode.cpp \
+            src/nodes/BloomNode.cpp \
+            src/nodes/DofNode.cpp \
+            src/cpu/RayMarcher.cpp \
+            src/cpu/TileScheduler.cpp
+
+QMAKE_CXXFLAGS += -std=c++0x -g -O2 -pthread
+
+# GL error checking: 0 = off, 1 = glGetError at each CHECKERROR, 2 = KHR_debug callback
+CONFIG(release, debug|release): DEFINES += GL_CHECK_MODE=0
+
+LIBS += -lGLEW -lEGL -lGL -pthread ./extern/kiwi/libkiwicpp.a
+DESTDIR = ./bin/
+TARGET = raymarcher-batch
@@ -0,0 +1,90 @@
+#include "batch/FrameReadback.hpp"
+#include "renderer/FrameBuffer.hpp"
+#include "utils/CheckGLError.hpp"
+
+#include <string.h>
+#include <assert.h>
+#include <iostream>
+
+namespace batch{
+
+FrameReadback::FrameReadback( int width, int height, unsigned int depth )
+: _width(width), _height(height), _slots(depth), _first(0), _count(0)
+{
+    assert( depth > 0 );
+    for( unsigned int i = 0; i < _slots.size(); ++i )
+    {
+        glGenBuffers( 1, &_slots[i].buffer );
+        glBindBuffer( GL_PIXEL_PACK_BUFFER, _slots[i].buffer );
+        glBufferData( GL_PIXEL_PACK_BUFFER, _width * _height * 4 * sizeof(float), 0, GL_STREAM_READ );
+        _slots[i].fence = 0;
+        _slots[i].frame = -1;
+    }
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+    CHECKERROR
+}
+
+FrameReadback::~FrameReadback()
+{
+    for( unsigned int i = 0; i < _slots.size(); ++i )
+    {
+        if( _slots[i].fence )
+            glDeleteSync( _slots[i].fence );
+        glDeleteBuffers( 1, &_slots[i].buffer );
+    }
+}
+
+void FrameReadback::start( const renderer::FrameBuffer * fbo, int frame )
+{
+    assert( !full() );
+    Slot& slot = _slots[ (_first + _count) % _slots.size() ];
+    ++_count;
+
+    glBindFramebuffer( GL_READ_FRAMEBUFFER, fbo->id() );
+    glReadBuffer( GL_COLOR_ATTACHMENT0 );
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.buffer );
+    // into the buffer: returns without waiting for the frame
+    glReadPixels( 0, 0, _width, _height, GL_RGBA, GL_FLOAT, 0 );
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+    glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+
+    slot.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    slot.frame = frame;
+    // gets the GPU going on the frame while the CPU does something else
+    glFlush();
+    CHECKERROR
+}
+
+int FrameReadback::finish( std::vector<float>& pixels )
+{
+    if( empty() )
+        return -1;
+    Slot& slot = _slots[_first];
+    _first = (_first + 1) % _slots.size();
+    --_count;
+
+    while( glClientWaitSync( slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000 ) == GL_TIMEOUT_EXPIRED )
+        ;
+    glDeleteSync( slot.fence );
+    slot.fence = 0;
+
+    unsigned int size = _width * _height * 4;
+    pixels.resize( size );
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.buffer );
+    const void * data = glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, size * sizeof(float), GL_MAP_READ_BIT );
+    if( data )
+    {
+        memcpy( &pixels[0], data, size * sizeof(float) );
+        glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+    }
+    else
+    {
+        std::cerr << "FrameReadback error! could not map the pixels of frame " << slot.frame
+                  << ", GL error 0x" << std::hex << glGetError() << std::dec << std::endl;
+    }
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+    CHECKERROR
+    return data ? slot.frame : -1;
+}
+
+}//namespace
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef BATCH_FRAMEREADBACK_HPP
+#define BATCH_FRAMEREADBACK_HPP
+
+#include <GL/glew.h>
+#include <vector>
+
+namespace renderer{ class FrameBuffer; }
+
+namespace batch{
+
+// Reads rendered frames back through a ring of pixel buffer objects:
+// start() only queues the copy, and the pixels of a frame are fetched by
+// finish() once later frames were submitted, so that the GPU keeps
+// rendering while the CPU writes the previous frames.
+class FrameReadback
+{
+public:
+    FrameReadback( int width, int height, unsigned int depth = 3 );
+    ~FrameReadback();
+
+    // Queues the copy of the first attachment of the frame buffer. The
+    // ring must not be full.
+    void start( const renderer::FrameBuffer * fbo, int frame );
+
+    // Waits for the oldest queued frame and copies its RGBA float pixels.
+    // Returns its frame number, -1 if the ring is empty.
+    int finish( std::vector<float>& pixels );
+
+    bool full() const
+    {
+        return _count == _slots.size();
+    }
+
+    bool empty() const
+    {
+        return _count == 0;
+    }
+
+private:
+    struct Slot
+    {
+        GLuint buffer;
+        GLsync fence;
+        int frame;
+    };
+
+    int _width;
+    int _height;
+    std::vector<Slot> _slots;
+    // oldest queued slot and number of queued slots
+    unsigned int _first;
+    unsigned int _count;
+};
+
+}//namespace
+
+#endif
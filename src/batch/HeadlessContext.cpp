@@ -0,0 +1,122 @@
+#include "batch/HeadlessContext.hpp"
+#include "utils/CheckGLError.hpp"
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <iostream>
+
+using namespace std;
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace batch{
+
+static EGLDisplay s_display = EGL_NO_DISPLAY;
+static EGLContext s_context = EGL_NO_CONTEXT;
+
+static EGLDisplay OpenDisplay()
+{
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+        eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if( getPlatformDisplay )
+    {
+        EGLDisplay dpy = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0 );
+        if( dpy != EGL_NO_DISPLAY )
+            return dpy;
+    }
+    return eglGetDisplay( EGL_DEFAULT_DISPLAY );
+}
+
+bool CreateHeadlessContext()
+{
+    s_display = OpenDisplay();
+    EGLint major, minor;
+    if( s_display == EGL_NO_DISPLAY || !eglInitialize( s_display, &major, &minor ) )
+    {
+        cerr << "ERROR: could not initialize EGL" << endl;
+        return false;
+    }
+    cout << "INFO: EGL " << major << "." << minor
+         << " (" << eglQueryString( s_display, EGL_VENDOR ) << ")" << endl;
+
+    if( !eglBindAPI( EGL_OPENGL_API ) )
+    {
+        cerr << "ERROR: EGL can't create desktop OpenGL contexts" << endl;
+        return false;
+    }
+
+    const EGLint configAttribs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint nbConfigs = 0;
+    if( !eglChooseConfig( s_display, configAttribs, &config, 1, &nbConfigs ) || nbConfigs == 0 )
+    {
+        cerr << "ERROR: no suitable EGL config" << endl;
+        return false;
+    }
+
+    // the shaders use texture2D, which core profiles may reject
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+        EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT_KHR,
+#if GL_CHECK_MODE == GL_CHECK_DEBUG
+        EGL_CONTEXT_FLAGS_KHR, EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR,
+#endif
+        EGL_NONE
+    };
+    s_context = eglCreateContext( s_display, config, EGL_NO_CONTEXT, contextAttribs );
+    if( s_context == EGL_NO_CONTEXT )
+    {
+        cerr << "ERROR: could not create an OpenGL 3.3 context" << endl;
+        return false;
+    }
+
+    // EGL_KHR_surfaceless_context: everything is rendered to FBOs
+    if( !eglMakeCurrent( s_display, EGL_NO_SURFACE, EGL_NO_SURFACE, s_context ) )
+    {
+        cerr << "ERROR: could not make the context current" << endl;
+        return false;
+    }
+
+    glewExperimental = GL_TRUE;
+    GLenum glewResult = glewInit();
+    // GLEW built for GLX loads the GL entry points and then fails looking
+    // for a GLX display, which is expected here.
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    if( glewResult == GLEW_ERROR_NO_GLX_DISPLAY )
+        glewResult = GLEW_OK;
+#endif
+    if( glewResult != GLEW_OK )
+    {
+        cerr << "ERROR: " << glewGetErrorString( glewResult ) << endl;
+        return false;
+    }
+
+    cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION)
+         << " (" << glGetString(GL_RENDERER) << ")" << endl;
+
+    gl_init_error_check();
+    return true;
+}
+
+void DestroyHeadlessContext()
+{
+    if( s_display == EGL_NO_DISPLAY )
+        return;
+    eglMakeCurrent( s_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+    if( s_context != EGL_NO_CONTEXT )
+        eglDestroyContext( s_display, s_context );
+    eglTerminate( s_display );
+    s_context = EGL_NO_CONTEXT;
+    s_display = EGL_NO_DISPLAY;
+}
+
+}//namespace
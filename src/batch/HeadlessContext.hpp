@@ -0,0 +1,15 @@
+#pragma once
+#ifndef BATCH_HEADLESSCONTEXT_HPP
+#define BATCH_HEADLESSCONTEXT_HPP
+
+namespace batch{
+
+// Creates an OpenGL 3.3 context with no window and no default framebuffer,
+// using EGL on Mesa's surfaceless platform when available (works with
+// llvmpipe, no GPU or display server needed), and makes it current.
+bool CreateHeadlessContext();
+void DestroyHeadlessContext();
+
+}//namespace
+
+#endif
@@ -0,0 +1,392 @@
+// Offline renderer: evaluates the node graph without Qt or a window and
+// writes one image per frame.
+//
+// raymarcher-batch [--width W] [--height H] [--first F] [--last L]
+//                  [--output PREFIX] [--profile] [--heatmap] [--normals central|tetrahedron]
+//                  [--no-fusion] [--no-compute] [--batch N]
+//                  [--cpu [--threads N] [--tile-size N] [--tile-stats]]
+//                  [effect[:input=value,...]]...
+//
+// Effects are post-fx node names ("Sepia", "Edge detection", ...) chained
+// after the ray marcher in the given order. Values are either a float or
+// r/g/b for colour inputs, e.g. "Corners:factor=3,offset=0.6,cornerColor=0/0/0".
+//
+// With --cpu the ray marcher's output is computed by the C++ port of the
+// shader instead, which needs no GL at all (post effects are not available).
+//
+// --profile prints the average CPU and GPU time of each node at the end.
+// --tile-stats prints how long each tile of each frame took.
+// --heatmap colors the marcher's pixels by the number of steps of their ray.
+// --normals central uses the six-tap normals instead of the four-tap ones.
+// --no-fusion draws every effect in its own pass, instead of drawing chains
+// of point-wise effects (Sepia, Black and white, Corners...) in one.
+// --no-compute draws Edge detection with its fragment shader even when
+// compute shaders are available.
+// --batch sets how many frames are rendered together: the timer and the
+// other value nodes are evaluated for all of them first, then the GPU
+// renders them back to back (see renderer::ProcessFrames). The frames are
+// read back through a ring of pixel buffers, so that writing a frame to
+// disk overlaps the rendering of the next ones. --batch 0 renders each
+// frame with renderer::ProcessNodes instead, like the application; the
+// images must be the same (see CHECK_BATCH.sh).
+#include <GL/glew.h>
+
+#include "batch/HeadlessContext.hpp"
+#include "batch/FrameReadback.hpp"
+#include "renderer/Pipeline.hpp"
+#include "renderer/RenderSize.hpp"
+#include "renderer/NodeSchedule.hpp"
+#include "renderer/Profiler.hpp"
+#include "renderer/FrameBuffer.hpp"
+#include "utils/SaveImage.hpp"
+#include "utils/CheckGLError.hpp"
+#include "cpu/RayMarcher.hpp"
+
+#include "nodes/TimeNode.hpp"
+#include "nodes/ColorNode.hpp"
+#include "nodes/PostFxNode.hpp"
+#include "nodes/RayMarchingNode.hpp"
+
+#include "kiwi/core/all.hpp"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <assert.h>
+
+using namespace std;
+using namespace kiwi::core;
+
+void InitKiwi();
+
+namespace batch{
+
+struct Options
+{
+    Options()
+    : width(600), height(282), first(0), last(0), output("frame")
+    , cpu(false), threads(0), tileSize(32), tileStats(false), profile(false), heatmap(false)
+    , tetrahedronNormals(true), fusion(true), compute(true), batchSize(8) {}
+
+    int width;
+    int height;
+    int first;
+    int last;
+    string output;
+    bool cpu;
+    unsigned int threads;
+    int tileSize;
+    bool tileStats;
+    bool profile;
+    bool heatmap;
+    bool tetrahedronNormals;
+    bool fusion;
+    bool compute;
+    int batchSize;
+    vector<string> effects;
+};
+
+static void Usage()
+{
+    cerr << "usage: raymarcher-batch [--width W] [--height H] [--first F] [--last L]\n"
+         << "                        [--output PREFIX] [--profile] [--heatmap] [--normals central|tetrahedron]\n"
+         << "                        [--no-fusion] [--no-compute] [--batch N]\n"
+         << "                        [--cpu [--threads N] [--tile-size N] [--tile-stats]]\n"
+         << "                        [effect[:input=value,...]]...\n";
+}
+
+static bool ParseOptions( int argc, char* argv[], Options& opt )
+{
+    for( int i = 1; i < argc; ++i )
+    {
+        string arg = argv[i];
+        bool hasValue = i+1 < argc;
+        if( arg == "--width" && hasValue )       opt.width  = atoi( argv[++i] );
+        else if( arg == "--height" && hasValue ) opt.height = atoi( argv[++i] );
+        else if( arg == "--first" && hasValue )  opt.first  = atoi( argv[++i] );
+        else if( arg == "--last" && hasValue )   opt.last   = atoi( argv[++i] );
+        else if( arg == "--output" && hasValue ) opt.output = argv[++i];
+        else if( arg == "--threads" && hasValue ) opt.threads = atoi( argv[++i] );
+        else if( arg == "--tile-size" && hasValue ) opt.tileSize = atoi( argv[++i] );
+        else if( arg == "--tile-stats" )         opt.tileStats = true;
+        else if( arg == "--profile" )            opt.profile = true;
+        else if( arg == "--heatmap" )            opt.heatmap = true;
+        else if( arg == "--normals" && hasValue )
+        {
+            string mode = argv[++i];
+            if( mode != "central" && mode != "tetrahedron" )
+                return false;
+            opt.tetrahedronNormals = mode == "tetrahedron";
+        }
+        else if( arg == "--no-fusion" )          opt.fusion = false;
+        else if( arg == "--no-compute" )         opt.compute = false;
+        else if( arg == "--batch" && hasValue )  opt.batchSize = atoi( argv[++i] );
+        else if( arg == "--cpu" )                opt.cpu = true;
+        else if( arg.size() > 0 && arg[0] == '-' ) return false;
+        else opt.effects.push_back( arg );
+    }
+    if( opt.last < opt.first ) opt.last = opt.first;
+    if( opt.cpu && !opt.effects.empty() )
+    {
+        cerr << "post effects are not available with --cpu\n";
+        return false;
+    }
+    return opt.width > 0 && opt.height > 0 && opt.batchSize >= 0;
+}
+
+static int InputIndex( Node * n, const string& name )
+{
+    for( unsigned int i = 0; i < n->inputs().size(); ++i )
+        if( n->input(i).name() == name )
+            return i;
+    return -1;
+}
+
+// "name=1.0" or "name=r/g/b"
+static bool SetInput( Node * n, const string& assignment )
+{
+    size_t eq = assignment.find('=');
+    if( eq == string::npos )
+        return false;
+    int i = InputIndex( n, assignment.substr(0, eq) );
+    if( i < 0 )
+        return false;
+
+    string value = assignment.substr( eq+1 );
+    if( n->input(i).dataType() == DataTypeManager::TypeOf("Vec3") )
+    {
+        glm::vec3 color;
+        if( sscanf( value.c_str(), "%f/%f/%f", &color.r, &color.g, &color.b ) != 3 )
+            return false;
+        return nodes::CreateColorNode( color )->output() >> n->input(i);
+    }
+    auto floatNode = NodeTypeManager::Create("Float");
+    *floatNode->output().dataAs<float>() = atof( value.c_str() );
+    return floatNode->output() >> n->input(i);
+}
+
+// Builds "effect[:input=value,...]" and plugs it after previous.
+static Node * AddEffect( const string& spec, Node * previous, Node * rayMarcher )
+{
+    size_t colon = spec.find(':');
+    string name = spec.substr( 0, colon );
+    if( NodeTypeManager::TypeOf(name) == 0 )
+    {
+        cerr << "ERROR: unknown effect " << name << endl;
+        return 0;
+    }
+    Node * n = nodes::CreatePostFxNode( name );
+
+    while( colon != string::npos )
+    {
+        size_t next = spec.find( ',', colon+1 );
+        string assignment = spec.substr( colon+1, next == string::npos ? string::npos : next-colon-1 );
+        if( !SetInput( n, assignment ) )
+        {
+            cerr << "ERROR: bad input " << assignment << " for " << name << endl;
+            return 0;
+        }
+        colon = next;
+    }
+
+    auto textureTypeInfo = DataTypeManager::TypeOf("Texture2D");
+    auto vec3TypeInfo = DataTypeManager::TypeOf("Vec3");
+    auto floatTypeInfo = DataTypeManager::TypeOf("Float");
+    for( unsigned int i = 0; i < n->inputs().size(); ++i )
+    {
+        InputPort& in = n->input(i);
+        if( in.isConnected() )
+            continue;
+        bool connected = true;
+        if( in.dataType() == textureTypeInfo )
+        {
+            if( in.name() == "fragmentInfo" )
+                connected = rayMarcher->output(2) >> in;
+            else
+                connected = previous->output(1) >> in;
+        }
+        else if( in.dataType() == vec3TypeInfo )
+            connected = nodes::CreateColorNode()->output() >> in;
+        else if( in.dataType() == floatTypeInfo )
+        {
+            auto floatNode = NodeTypeManager::Create("Float");
+            *floatNode->output().dataAs<float>() = 1.0f;
+            connected = floatNode->output() >> in;
+        }
+        if( !connected )
+        {
+            cerr << "ERROR: could not connect " << name << "." << in.name() << endl;
+            return 0;
+        }
+    }
+    return n;
+}
+
+static string FramePath( const Options& opt, int frame )
+{
+    char path[1024];
+    snprintf( path, sizeof(path), "%s%04d.ppm", opt.output.c_str(), frame );
+    return path;
+}
+
+static int RunCpu( const Options& opt )
+{
+    cpu::MarcherParams params;
+    params.heatmap = opt.heatmap;
+    params.tetrahedronNormals = opt.tetrahedronNormals;
+    cpu::MarcherImage image;
+    image.resize( opt.width, opt.height );
+    cpu::TileScheduler scheduler( opt.threads, opt.tileSize );
+
+    for( int frame = opt.first; frame <= opt.last; ++frame )
+    {
+        params.time = frame;
+        cpu::RenderFrame( params, image, scheduler );
+        if( opt.tileStats )
+        {
+            cout << "frame " << frame << ": ";
+            scheduler.printStats( cout );
+        }
+
+        string path = FramePath( opt, frame );
+        if( !utils::SavePPM( path, opt.width, opt.height, &image.color[0].x ) )
+            return EXIT_FAILURE;
+        cout << "wrote " << path << endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Queues the readback of each frame the schedule renders, and writes the
+// frames whose pixels came back.
+class FrameSaver : public renderer::FrameSink
+{
+public:
+    FrameSaver( const Options& opt, Node * last )
+    : _opt(opt), _last(last), _readback(opt.width, opt.height), _firstFrame(0)
+    {
+    }
+
+    // number of the frame of index 0 of the next batch
+    void setFirstFrame( int frame )
+    {
+        _firstFrame = frame;
+    }
+
+    bool frameProcessed( unsigned int index )
+    {
+        if( _readback.full() && !saveOldest() )
+            return false;
+        _readback.start( *_last->output(0).dataAs<renderer::FrameBuffer*>(), _firstFrame + index );
+        return true;
+    }
+
+    // writes the frames still in flight
+    bool finish()
+    {
+        while( !_readback.empty() )
+            if( !saveOldest() )
+                return false;
+        return true;
+    }
+
+private:
+    bool saveOldest()
+    {
+        int frame = _readback.finish( _pixels );
+        if( frame < 0 )
+            return false;
+        string path = FramePath( _opt, frame );
+        if( !utils::SavePPM( path, _opt.width, _opt.height, &_pixels[0] ) )
+            return false;
+        cout << "wrote " << path << endl;
+        return true;
+    }
+
+    const Options& _opt;
+    Node * _last;
+    FrameReadback _readback;
+    vector<float> _pixels;
+    int _firstFrame;
+};
+
+static int Run( const Options& opt )
+{
+    renderer::SetRenderSize( opt.width, opt.height );
+    glViewport( 0, 0, opt.width, opt.height );
+
+    renderer::SetNormalEstimation( opt.tetrahedronNormals ? renderer::TETRAHEDRON_NORMALS
+                                                          : renderer::CENTRAL_DIFFERENCE_NORMALS );
+    renderer::SetPostFxFusion( opt.fusion );
+    renderer::SetComputePostFx( opt.compute );
+    renderer::InitPipeline();
+    nodes::SetMarcherHeatmap( opt.heatmap );
+
+    Node * timeNode = nodes::CreateTimeNode();
+    Node * rayMarcher = nodes::CreateRayMarchingNode();
+    if( !(timeNode->output() >> rayMarcher->input(6)) )
+        return EXIT_FAILURE;
+    // the marcher's buffers are created at a default size
+    renderer::ResizeFrameBuffers( renderer::GetTargetWidth(), renderer::GetTargetHeight() );
+
+    Node * last = rayMarcher;
+    for( unsigned int i = 0; i < opt.effects.size(); ++i )
+    {
+        last = AddEffect( opt.effects[i], last, rayMarcher );
+        if( !last )
+            return EXIT_FAILURE;
+    }
+
+    // the timer increments before being read
+    *timeNode->output().dataAs<float>() = opt.first - 1;
+
+    FrameSaver saver( opt, last );
+    for( int frame = opt.first; frame <= opt.last; frame += max( opt.batchSize, 1 ) )
+    {
+        saver.setFirstFrame( frame );
+        if( opt.batchSize == 0 )
+        {
+            renderer::ProcessNodes( last );
+            if( !saver.frameProcessed( 0 ) )
+                return EXIT_FAILURE;
+        }
+        else if( !renderer::ProcessFrames( last, min( opt.batchSize, opt.last - frame + 1 ), saver ) )
+            return EXIT_FAILURE;
+    }
+    if( !saver.finish() )
+        return EXIT_FAILURE;
+
+    if( opt.profile )
+    {
+        renderer::FlushProfile();
+        renderer::PrintProfile( cout );
+    }
+    return EXIT_SUCCESS;
+}
+
+}//namespace
+
+int main( int argc, char* argv[] )
+{
+    batch::Options opt;
+    if( !batch::ParseOptions( argc, argv, opt ) )
+    {
+        batch::Usage();
+        return EXIT_FAILURE;
+    }
+
+    if( opt.cpu )
+        return batch::RunCpu( opt );
+
+    InitKiwi();
+
+    if( !batch::CreateHeadlessContext() )
+        return EXIT_FAILURE;
+
+    int result = batch::Run( opt );
+
+    batch::DestroyHeadlessContext();
+    return result;
+}
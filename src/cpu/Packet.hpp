@@ -0,0 +1,168 @@
+
+#pragma once
+#ifndef CPU_PACKET_HPP
+#define CPU_PACKET_HPP
+
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace cpu{
+
+// Four floats processed in lock step, one lane per ray. Arithmetic maps to
+// SSE when available; transcendental functions are evaluated per lane.
+// Comparisons return masks (all bits set in the lanes where they hold)
+// that are consumed by Select, Any and All.
+struct Float4
+{
+    enum { WIDTH = 4 };
+
+#ifdef __SSE2__
+    __m128 v;
+
+    Float4() {}
+    Float4( float f ) : v( _mm_set1_ps(f) ) {}
+    Float4( __m128 m ) : v(m) {}
+    Float4( float a, float b, float c, float d ) : v( _mm_setr_ps(a,b,c,d) ) {}
+
+    float operator[]( int i ) const
+    {
+        float lanes[WIDTH];
+        _mm_storeu_ps( lanes, v );
+        return lanes[i];
+    }
+#else
+    float v[WIDTH];
+
+    Float4() {}
+    Float4( float f ) { v[0] = v[1] = v[2] = v[3] = f; }
+    Float4( float a, float b, float c, float d ) { v[0] = a; v[1] = b; v[2] = c; v[3] = d; }
+
+    float operator[]( int i ) const
+    {
+        return v[i];
+    }
+#endif
+};
+
+#ifdef __SSE2__
+
+inline Float4 operator+( Float4 a, Float4 b ) { return _mm_add_ps(a.v, b.v); }
+inline Float4 operator-( Float4 a, Float4 b ) { return _mm_sub_ps(a.v, b.v); }
+inline Float4 operator*( Float4 a, Float4 b ) { return _mm_mul_ps(a.v, b.v); }
+inline Float4 operator/( Float4 a, Float4 b ) { return _mm_div_ps(a.v, b.v); }
+inline Float4 operator-( Float4 a ) { return _mm_sub_ps(_mm_setzero_ps(), a.v); }
+inline Float4 Min( Float4 a, Float4 b ) { return _mm_min_ps(a.v, b.v); }
+inline Float4 Max( Float4 a, Float4 b ) { return _mm_max_ps(a.v, b.v); }
+inline Float4 Sqrt( Float4 a ) { return _mm_sqrt_ps(a.v); }
+inline Float4 Abs( Float4 a ) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+
+inline Float4 operator<( Float4 a, Float4 b ) { return _mm_cmplt_ps(a.v, b.v); }
+inline Float4 operator>( Float4 a, Float4 b ) { return _mm_cmpgt_ps(a.v, b.v); }
+inline Float4 operator&( Float4 a, Float4 b ) { return _mm_and_ps(a.v, b.v); }
+inline Float4 operator|( Float4 a, Float4 b ) { return _mm_or_ps(a.v, b.v); }
+inline Float4 AndNot( Float4 mask, Float4 b ) { return _mm_andnot_ps(mask.v, b.v); }
+
+// mask ? a : b
+inline Float4 Select( Float4 mask, Float4 a, Float4 b )
+{
+    return _mm_or_ps( _mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v) );
+}
+
+inline bool Any( Float4 mask ) { return _mm_movemask_ps(mask.v) != 0; }
+inline bool All( Float4 mask ) { return _mm_movemask_ps(mask.v) == 0xF; }
+inline bool Lane( Float4 mask, int i ) { return (_mm_movemask_ps(mask.v) >> i) & 1; }
+
+inline Float4 Floor( Float4 a )
+{
+    // truncate then correct the negative non integer values
+    __m128 t = _mm_cvtepi32_ps( _mm_cvttps_epi32(a.v) );
+    __m128 fix = _mm_and_ps( _mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f) );
+    // values too big for an int are already integers
+    __m128 big = _mm_cmpge_ps( Abs(a).v, _mm_set1_ps(8388608.0f) );
+    return Select( big, a, _mm_sub_ps(t, fix) );
+}
+
+#else
+
+#define CPU_PACKET_BINARY( op ) \
+inline Float4 operator op ( Float4 a, Float4 b ) \
+{ return Float4( a.v[0] op b.v[0], a.v[1] op b.v[1], a.v[2] op b.v[2], a.v[3] op b.v[3] ); }
+
+CPU_PACKET_BINARY(+)
+CPU_PACKET_BINARY(-)
+CPU_PACKET_BINARY(*)
+CPU_PACKET_BINARY(/)
+#undef CPU_PACKET_BINARY
+
+inline float MaskOf( bool b ) { union { unsigned int i; float f; } u; u.i = b ? 0xFFFFFFFFu : 0u; return u.f; }
+inline bool IsSet( float f ) { union { unsigned int i; float f; } u; u.f = f; return u.i != 0; }
+
+inline Float4 operator-( Float4 a ) { return Float4( -a.v[0], -a.v[1], -a.v[2], -a.v[3] ); }
+inline Float4 Min( Float4 a, Float4 b ) { return Float4( fminf(a.v[0],b.v[0]), fminf(a.v[1],b.v[1]), fminf(a.v[2],b.v[2]), fminf(a.v[3],b.v[3]) ); }
+inline Float4 Max( Float4 a, Float4 b ) { return Float4( fmaxf(a.v[0],b.v[0]), fmaxf(a.v[1],b.v[1]), fmaxf(a.v[2],b.v[2]), fmaxf(a.v[3],b.v[3]) ); }
+inline Float4 Sqrt( Float4 a ) { return Float4( sqrtf(a.v[0]), sqrtf(a.v[1]), sqrtf(a.v[2]), sqrtf(a.v[3]) ); }
+inline Float4 Abs( Float4 a ) { return Float4( fabsf(a.v[0]), fabsf(a.v[1]), fabsf(a.v[2]), fabsf(a.v[3]) ); }
+inline Float4 Floor( Float4 a ) { return Float4( floorf(a.v[0]), floorf(a.v[1]), floorf(a.v[2]), floorf(a.v[3]) ); }
+
+inline Float4 operator<( Float4 a, Float4 b ) { return Float4( MaskOf(a.v[0]<b.v[0]), MaskOf(a.v[1]<b.v[1]), MaskOf(a.v[2]<b.v[2]), MaskOf(a.v[3]<b.v[3]) ); }
+inline Float4 operator>( Float4 a, Float4 b ) { return b < a; }
+inline Float4 operator&( Float4 a, Float4 b ) { return Float4( MaskOf(IsSet(a.v[0])&&IsSet(b.v[0])), MaskOf(IsSet(a.v[1])&&IsSet(b.v[1])), MaskOf(IsSet(a.v[2])&&IsSet(b.v[2])), MaskOf(IsSet(a.v[3])&&IsSet(b.v[3])) ); }
+inline Float4 operator|( Float4 a, Float4 b ) { return Float4( MaskOf(IsSet(a.v[0])||IsSet(b.v[0])), MaskOf(IsSet(a.v[1])||IsSet(b.v[1])), MaskOf(IsSet(a.v[2])||IsSet(b.v[2])), MaskOf(IsSet(a.v[3])||IsSet(b.v[3])) ); }
+inline Float4 AndNot( Float4 mask, Float4 b ) { return Float4( MaskOf(!IsSet(mask.v[0])&&IsSet(b.v[0])), MaskOf(!IsSet(mask.v[1])&&IsSet(b.v[1])), MaskOf(!IsSet(mask.v[2])&&IsSet(b.v[2])), MaskOf(!IsSet(mask.v[3])&&IsSet(b.v[3])) ); }
+
+inline Float4 Select( Float4 mask, Float4 a, Float4 b )
+{
+    return Float4( IsSet(mask.v[0]) ? a.v[0] : b.v[0], IsSet(mask.v[1]) ? a.v[1] : b.v[1]
+                 , IsSet(mask.v[2]) ? a.v[2] : b.v[2], IsSet(mask.v[3]) ? a.v[3] : b.v[3] );
+}
+
+inline bool Lane( Float4 mask, int i ) { return IsSet(mask.v[i]); }
+inline bool Any( Float4 mask ) { return Lane(mask,0) || Lane(mask,1) || Lane(mask,2) || Lane(mask,3); }
+inline bool All( Float4 mask ) { return Lane(mask,0) && Lane(mask,1) && Lane(mask,2) && Lane(mask,3); }
+
+#endif
+
+inline Float4 Clamp( Float4 a, Float4 lo, Float4 hi ) { return Min( Max(a, lo), hi ); }
+inline Float4 Mix( Float4 a, Float4 b, Float4 t ) { return a + (b - a) * t; }
+
+// GLSL's mod: x - y * floor(x/y)
+inline Float4 Mod( Float4 x, Float4 y ) { return x - y * Floor(x / y); }
+
+#define CPU_PACKET_UNARY( name, func ) \
+inline Float4 name( Float4 a ) { return Float4( func(a[0]), func(a[1]), func(a[2]), func(a[3]) ); }
+
+CPU_PACKET_UNARY( Sin, sinf )
+CPU_PACKET_UNARY( Cos, cosf )
+CPU_PACKET_UNARY( Exp, expf )
+#undef CPU_PACKET_UNARY
+
+struct Vec3x4
+{
+    Vec3x4() {}
+    Vec3x4( Float4 a, Float4 b, Float4 c ) : x(a), y(b), z(c) {}
+    Float4 x, y, z;
+};
+
+inline Vec3x4 operator+( const Vec3x4& a, const Vec3x4& b ) { return Vec3x4( a.x+b.x, a.y+b.y, a.z+b.z ); }
+inline Vec3x4 operator-( const Vec3x4& a, const Vec3x4& b ) { return Vec3x4( a.x-b.x, a.y-b.y, a.z-b.z ); }
+inline Vec3x4 operator*( const Vec3x4& a, Float4 s ) { return Vec3x4( a.x*s, a.y*s, a.z*s ); }
+inline Float4 Dot( const Vec3x4& a, const Vec3x4& b ) { return a.x*b.x + a.y*b.y + a.z*b.z; }
+inline Float4 Length( const Vec3x4& a ) { return Sqrt( Dot(a,a) ); }
+inline Vec3x4 Normalize( const Vec3x4& a ) { return a * ( Float4(1.0f) / Length(a) ); }
+
+inline Vec3x4 Select( Float4 mask, const Vec3x4& a, const Vec3x4& b )
+{
+    return Vec3x4( Select(mask, a.x, b.x), Select(mask, a.y, b.y), Select(mask, a.z, b.z) );
+}
+
+inline Vec3x4 Mix( const Vec3x4& a, const Vec3x4& b, Float4 t )
+{
+    return Vec3x4( Mix(a.x, b.x, t), Mix(a.y, b.y, t), Mix(a.z, b.z, t) );
+}
+
+}//namespace
+
+#endif
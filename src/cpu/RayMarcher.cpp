@@ -0,0 +1,414 @@
+#include "cpu/RayMarcher.hpp"
+#include "cpu/Packet.hpp"
+
+#include <functional>
+#include <vector>
+#include <math.h>
+
+namespace cpu{
+
+// Keep these in sync with shaders/Raymarching.frag
+static const int MAX_STEPS = 200;
+static const float EPSILON = 0.01f;
+static const float PI = 3.14159265f;
+
+// bounds of the object groups: nothing but the ground and the sky above
+// BUILDINGS_TOP, no sphere above SPHERES_TOP. Further than BOUND_MARGIN
+// above the buildings, the roof plane replaces the buildings distance.
+static const float BUILDINGS_TOP = 12.0f;
+static const float SPHERES_TOP = 8.0f;
+static const float BOUND_MARGIN = 1.0f;
+
+enum { SKY_MTL = 0, GROUND_MTL = 1, BUILDINGS_MTL = 2, RED_MTL = 3, FOG_MTL = 4 };
+
+// ApplyFog starts at FOG_START and decreases by exp(-FOG_DENSITY) per unit
+static const float FOG_START = 300.0f;
+static const float FOG_DENSITY = 0.01f;
+
+static Float4 TrueMask()
+{
+    return Float4(0.0f) < Float4(1.0f);
+}
+
+static Vec3x4 Splat( const glm::vec3& v )
+{
+    return Vec3x4( Float4(v.x), Float4(v.y), Float4(v.z) );
+}
+
+static Float4 SphereDistance( Vec3x4 point, const glm::vec3& center, float radius )
+{
+    point.z = Mod( point.z + Float4(15.0f), Float4(230.0f) ) - Float4(15.0f);
+    point.x = Mod( point.x + Float4(15.0f), Float4(230.0f) ) - Float4(15.0f);
+    return Length( point - Splat(center) ) - Float4(radius);
+}
+
+static Float4 CubeDistance2( const Vec3x4& point, const glm::vec3& size )
+{
+    Vec3x4 d(
+          Max( Abs(point.x) - Float4(size.x), Float4(0.0f) )
+        , Max( Abs(point.y) - Float4(size.y), Float4(0.0f) )
+        , Max( Abs(point.z) - Float4(size.z), Float4(0.0f) )
+    );
+    return Length( d );
+}
+
+// the repetition along y is 0 in the shader, which leaves y untouched
+static Float4 CubeRepetition( const Vec3x4& point, float repetitionX, float repetitionZ )
+{
+    Vec3x4 q(
+          Mod( point.x, Float4(repetitionX) ) - Float4(0.5f * repetitionX)
+        , point.y
+        , Mod( point.z, Float4(repetitionZ) ) - Float4(0.5f * repetitionZ)
+    );
+    return CubeDistance2( q, glm::vec3(2.0f, 10.0f, 2.0f) );
+}
+
+static Float4 RedDistance( const Vec3x4& position )
+{
+    return SphereDistance( position, glm::vec3(0.0f, 3.0f, 5.0f), 5.0f );
+}
+
+static Float4 BuildingsDistance( const Vec3x4& position )
+{
+    Vec3x4 theOtherPosition = position + Splat( glm::vec3(350.0f, -2.0f, 0.0f) );
+    return Min(
+          CubeRepetition( position, 17.0f, 20.0f )
+        , CubeRepetition( theOtherPosition, 23.0f, 23.0f )
+    );
+}
+
+static Float4 GroundDistance( const Vec3x4& position )
+{
+    return position.y;
+}
+
+// Lower bound of the buildings distance, exact near the buildings.
+static Float4 BoundedBuildingsDistance( const Vec3x4& position )
+{
+    Float4 roofDistance = position.y - Float4(BUILDINGS_TOP);
+    Float4 farAbove = roofDistance > Float4(BOUND_MARGIN);
+    if( All(farAbove) )
+        return roofDistance;
+    return Select( farAbove, roofDistance, BuildingsDistance( position ) );
+}
+
+// Distance to everything but the ground.
+static Float4 ObjectsDistance( const Vec3x4& position, Float4& mtl )
+{
+    Float4 closest = BoundedBuildingsDistance( position );
+    mtl = Float4( (float)BUILDINGS_MTL );
+
+    // the spheres are at least y - SPHERES_TOP away, skip them when
+    // something is closer
+    Float4 mayBeCloser = position.y - Float4(SPHERES_TOP) < closest;
+    if( Any(mayBeCloser) )
+    {
+        Float4 redDistance = RedDistance( position );
+        Float4 closer = mayBeCloser & ( redDistance < closest );
+        closest = Select( closer, redDistance, closest );
+        mtl = Select( closer, Float4((float)RED_MTL), mtl );
+    }
+
+    return closest;
+}
+
+static Float4 DistanceField( const Vec3x4& position, Float4& mtl )
+{
+    Float4 objDistance = ObjectsDistance( position, mtl );
+    Float4 gndDistance = GroundDistance( position );
+
+    Float4 closer = objDistance < gndDistance;
+    mtl = Select( closer, mtl, Float4( (float)GROUND_MTL ) );
+    return Select( closer, objDistance, gndDistance );
+}
+
+static Float4 DistanceField( const Vec3x4& position )
+{
+    Float4 dummy;
+    return DistanceField( position, dummy );
+}
+
+static Float4 Rand( Float4 x, Float4 y )
+{
+    Float4 s = Sin( x * Float4(12.9898f) + y * Float4(78.233f) ) * Float4(43758.5453f);
+    return ( s - Floor(s) + Float4(1.0f) ) * Float4(0.5f);
+}
+
+static Float4 Softshadow( const Vec3x4& landPoint, const Vec3x4& lightVector
+                        , float mint, float maxt, float iterations
+                        , Float4 noise, Float4 active )
+{
+    Float4 penumbraFactor( 1.0f );
+    Float4 t = Float4(mint) + noise * Float4(0.01f);
+    Float4 running = active & ( t < Float4(maxt) );
+
+    while( Any(running) )
+    {
+        Vec3x4 p = landPoint + lightVector * t;
+
+        // Above the buildings, every distance further along the ray is at
+        // least its height above them: the penumbra can not get lower than
+        // iterations * min(height / t, lightVector.y) anymore.
+        Float4 height = p.y - Float4(BUILDINGS_TOP);
+        Float4 penumbraBound = Float4(iterations) * Min( height / t, lightVector.y );
+        Float4 done = ( Float4(0.0f) < height ) & AndNot( penumbraBound < penumbraFactor, TrueMask() );
+        running = AndNot( done, running );
+        if( !Any(running) )
+            break;
+
+        Float4 nextDist = BuildingsDistance(p);
+        if( Any( p.y - Float4(SPHERES_TOP) < nextDist ) )
+            nextDist = Min( nextDist, RedDistance(p) );
+
+        Float4 blocked = running & ( nextDist < Float4(0.001f) );
+        penumbraFactor = Select( blocked, Float4(0.0f), penumbraFactor );
+        running = AndNot( blocked, running );
+
+        penumbraFactor = Select( running
+            , Min( penumbraFactor, Float4(iterations) * nextDist / t )
+            , penumbraFactor );
+        t = Select( running, t + nextDist, t );
+        running = running & ( t < Float4(maxt) );
+    }
+    return penumbraFactor;
+}
+
+// steps is the number of distance evaluations of each ray.
+static Vec3x4 RayMarch( const MarcherParams& params, const Vec3x4& origin, const Vec3x4& direction
+                      , Float4& mtl, Float4& steps )
+{
+    Float4 down = direction.y < Float4(0.0f);
+    // rays leaving the scene from above it are sky without marching
+    Float4 running = AndNot( AndNot( down, Float4(BUILDINGS_TOP) < origin.y ), TrueMask() );
+    mtl = Float4( (float)SKY_MTL );
+    steps = Float4( 0.0f );
+
+    // the rays coming from above start at the top of the buildings, and
+    // only the objects are marched: the ground is intersected in closed form
+    Float4 above = down & ( Float4(BUILDINGS_TOP) < origin.y );
+    Float4 t = Select( above, ( origin.y - Float4(BUILDINGS_TOP) ) / -direction.y, Float4(0.0f) );
+    Float4 groundT = Select( down, origin.y / -direction.y, Float4(1e30f) );
+    // past fogT the fog hides everything
+    Float4 fogT( params.fogCutoff > 0.0f ? FOG_START - logf(params.fogCutoff) / FOG_DENSITY : 1e30f );
+    Float4 endT = Min( groundT, fogT );
+    Float4 endMtl = Select( fogT < groundT, Float4((float)FOG_MTL), Float4((float)GROUND_MTL) );
+
+    // over-relaxed sphere tracing, see RayMarch in the shader
+    Float4 omega( fmaxf( params.relaxation, 1.0f ) );
+    Float4 tPrev = t;
+    Float4 dPrev( 0.0f );
+    Float4 hitT = t;
+    const Float4 one( 1.0f );
+
+    for( int i = 0; i < MAX_STEPS && Any(running); ++i )
+    {
+        steps = Select( running, steps + one, steps );
+
+        // the ground or the fog is reached once the last step is safe
+        Float4 atEnd = AndNot( t < endT, running );
+        Float4 unsafe = atEnd & ( one < omega ) & ( tPrev + dPrev < endT );
+        Float4 reached = AndNot( unsafe, atEnd );
+        mtl = Select( reached, endMtl, mtl );
+        hitT = Select( reached, endT, hitT );
+        running = AndNot( reached, running );
+        t = Select( unsafe, tPrev + dPrev, t );
+        omega = Select( unsafe, one, omega );
+
+        Float4 stepMtl;
+        Vec3x4 position = origin + direction * t;
+        Float4 nextDistance = ObjectsDistance( position, stepMtl );
+
+        Float4 overshot = running & ( one < omega ) & ( nextDistance + dPrev < t - tPrev );
+        t = Select( overshot, tPrev + dPrev, t );
+        omega = Select( overshot, one, omega );
+        Float4 valid = AndNot( overshot, running );
+
+        // the tolerance grows with the distance, like the pixel footprint
+        Float4 hit = valid & ( nextDistance < Max( Float4(0.001f), Float4(params.hitCone) * t ) );
+        mtl = Select( hit, stepMtl, mtl );
+        hitT = Select( hit, t, hitT );
+        running = AndNot( hit, running );
+
+        Float4 advance = AndNot( hit, valid );
+        tPrev = Select( advance, t, tPrev );
+        dPrev = Select( advance, nextDistance, dPrev );
+        t = Select( advance, t + nextDistance * omega, t );
+    }
+
+    // out of steps
+    mtl = Select( running & down, Float4((float)GROUND_MTL), mtl );
+    hitT = Select( running, t, hitT );
+
+    return origin + direction * hitT;
+}
+
+static Vec3x4 ComputeNormal( const Vec3x4& pos, bool tetrahedron )
+{
+    Float4 e( EPSILON );
+    if( tetrahedron )
+    {
+        // gradient from the four corners of a tetrahedron around pos
+        Float4 a = DistanceField( Vec3x4(pos.x + e, pos.y - e, pos.z - e) );
+        Float4 b = DistanceField( Vec3x4(pos.x - e, pos.y - e, pos.z + e) );
+        Float4 c = DistanceField( Vec3x4(pos.x - e, pos.y + e, pos.z - e) );
+        Float4 d = DistanceField( Vec3x4(pos.x + e, pos.y + e, pos.z + e) );
+        return Normalize( Vec3x4( a - b - c + d, -a - b + c + d, -a + b - c + d ) );
+    }
+    return Normalize( Vec3x4(
+          DistanceField( Vec3x4(pos.x + e, pos.y, pos.z) ) - DistanceField( Vec3x4(pos.x - e, pos.y, pos.z) )
+        , DistanceField( Vec3x4(pos.x, pos.y + e, pos.z) ) - DistanceField( Vec3x4(pos.x, pos.y - e, pos.z) )
+        , DistanceField( Vec3x4(pos.x, pos.y, pos.z + e) ) - DistanceField( Vec3x4(pos.x, pos.y, pos.z - e) )
+    ) );
+}
+
+static Float4 AmbientOcclusion( const Vec3x4& point, const Vec3x4& normal, float stepDistance, float samples )
+{
+    Float4 occlusion( 1.0f );
+    for( ; samples > 0.0f; samples -= 1.0f )
+    {
+        Float4 d = DistanceField( point + normal * Float4(samples * stepDistance) );
+        occlusion = occlusion - ( Float4(samples * stepDistance) - d ) / Float4( powf(2.0f, samples) );
+    }
+    return occlusion;
+}
+
+static void FishEyeCamera( Float4 screenX, Float4 screenY, float ratio, float fovy, float time
+                         , Vec3x4& position, Vec3x4& direction )
+{
+    screenY = screenY - Float4(0.2f);
+    screenX = screenX * Float4( PI * 0.5f / fovy );
+    screenY = screenY * Float4( PI * 0.5f / ratio / fovy );
+
+    Float4 a = screenY + Float4(PI * 0.5f);
+    Float4 sinA = Sin( a );
+    direction = Vec3x4( sinA * Sin(screenX), -Cos(a), sinA * Cos(screenX) );
+    position = Splat( glm::vec3(5.0f * sinf(time * 0.01f), 25.0f, time) );
+}
+
+// blue (no step) to green to red (MAX_STEPS), like HeatColor in the shader
+static Vec3x4 HeatColor( Float4 x )
+{
+    x = Clamp( x, Float4(0.0f), Float4(1.0f) );
+    Float4 low = x < Float4(0.5f);
+    Vec3x4 blue( Float4(0.0f), Float4(0.0f), Float4(1.0f) );
+    Vec3x4 green( Float4(0.0f), Float4(1.0f), Float4(0.0f) );
+    Vec3x4 red( Float4(1.0f), Float4(0.0f), Float4(0.0f) );
+    return Select( low, Mix( blue, green, x * Float4(2.0f) ), Mix( green, red, x * Float4(2.0f) - Float4(1.0f) ) );
+}
+
+static void ApplyFog( Float4 distance, Vec3x4& rgb, const glm::vec3& skyColor )
+{
+    Float4 fogAmount = Exp( -Max( distance - Float4(FOG_START), Float4(0.0f) ) * Float4(FOG_DENSITY) );
+    rgb = Mix( Splat(skyColor), rgb, fogAmount );
+}
+
+// Shades the pixels [x, x+4) of row y, like main() in the shader.
+static void RenderPacket( const MarcherParams& params, MarcherImage& image, int x, int y )
+{
+    const float w = (float)image.width;
+    const float h = (float)image.height;
+    const float ratio = w / h;
+
+    // gl_FragCoord is the center of the pixel
+    Float4 fragX( x + 0.5f, x + 1.5f, x + 2.5f, x + 3.5f );
+    Float4 fragY( y + 0.5f );
+
+    Vec3x4 position;
+    Vec3x4 direction;
+    FishEyeCamera( fragX / Float4(w) - Float4(0.5f), fragY / Float4(h) - Float4(0.5f)
+                 , ratio, params.fovyCoefficient, params.time, position, direction );
+
+    Float4 material;
+    Float4 steps;
+    Vec3x4 hitPosition = RayMarch( params, position, direction, material, steps );
+    Float4 fogged = Float4((float)RED_MTL + 0.5f) < material;
+    Float4 hasHit = AndNot( fogged, Float4((float)SKY_MTL + 0.5f) < material );
+
+    Vec3x4 hitColor;
+    Vec3x4 hitNormal;
+    Float4 distance;
+    if( Any(hasHit) )
+    {
+        float time = params.time;
+        glm::vec3 lightpos( 50.0f * sinf(time*0.01f), 10.0f + 40.0f * fabsf(cosf(time*0.01f)), time + 100.0f );
+        Vec3x4 lightVector = Normalize( Splat(lightpos) - hitPosition );
+
+        Float4 shadow = Softshadow( hitPosition, lightVector, 0.1f, 50.0f, params.shadowHardness
+                                  , Rand(fragX, fragY), hasHit );
+
+        hitNormal = ComputeNormal( hitPosition, params.tetrahedronNormals );
+        Float4 attenuation = Clamp( Dot(hitNormal, lightVector), Float4(0.0f), Float4(1.0f) ) * Float4(0.6f) + Float4(0.4f);
+        shadow = Min( shadow, attenuation );
+
+        Float4 isBuilding = Abs( material - Float4((float)BUILDINGS_MTL) ) < Float4(0.5f);
+        Float4 isRed = Abs( material - Float4((float)RED_MTL) ) < Float4(0.5f);
+        Vec3x4 mtlColor = Select( isRed, Splat(params.redColor), Splat(params.groundColor) );
+        Vec3x4 buildingColor = Mix( Splat(params.shadowColor), Splat(params.buildingsColor)
+                                  , Clamp( hitPosition.y / Float4(7.0f), Float4(0.0f), Float4(1.0f) ) );
+        mtlColor = Select( isBuilding, buildingColor, mtlColor );
+
+        hitColor = Mix( Splat(params.shadowColor), mtlColor, Float4(0.4f) + shadow * Float4(0.6f) );
+        Float4 AO = Clamp( AmbientOcclusion(hitPosition, hitNormal, 0.35f, 5.0f), Float4(0.0f), Float4(1.0f) );
+        hitColor = Mix( Splat(params.shadowColor), hitColor, AO );
+
+        distance = Length( position - hitPosition );
+        ApplyFog( distance, hitColor, params.skyColor );
+    }
+
+    Float4 shade = direction.y * Float4(5.0f);
+    Vec3x4 skyColor = Mix( Splat(params.skyColor), Splat(params.skyColor * 0.8f), shade );
+
+    Vec3x4 fogColor = Splat( params.skyColor );
+    Float4 fogDistance = Length( position - hitPosition );
+
+    if( params.heatmap )
+    {
+        hitColor = HeatColor( steps / Float4((float)MAX_STEPS) );
+        skyColor = fogColor = hitColor;
+    }
+
+    for( int i = 0; i < Float4::WIDTH && x + i < image.width; ++i )
+    {
+        int index = y * image.width + x + i;
+        if( Lane(fogged, i) )
+        {
+            image.color[index] = glm::vec4( fogColor.x[i], fogColor.y[i], fogColor.z[i], 1.0f );
+            image.fragmentInfo[index] = glm::vec4( 0.5f, 1.0f, 0.5f, fogDistance[i] );
+        }
+        else if( Lane(hasHit, i) )
+        {
+            image.color[index] = glm::vec4( hitColor.x[i], hitColor.y[i], hitColor.z[i], 1.0f );
+            image.fragmentInfo[index] = glm::vec4(
+                  hitNormal.x[i] * 0.5f + 0.5f
+                , hitNormal.y[i] * 0.5f + 0.5f
+                , hitNormal.z[i] * 0.5f + 0.5f
+                , distance[i] );
+        }
+        else
+        {
+            image.color[index] = glm::vec4( skyColor.x[i], skyColor.y[i], skyColor.z[i], 1.0f );
+            image.fragmentInfo[index] = glm::vec4( 1.0f, 1.0f, 1.0f, 10000000.0f );
+        }
+    }
+}
+
+static void RenderTile( const MarcherParams& params, MarcherImage& image, const Tile& tile )
+{
+    for( int y = tile.y; y < tile.y + tile.height; ++y )
+        for( int x = tile.x; x < tile.x + tile.width; x += Float4::WIDTH )
+            RenderPacket( params, image, x, y );
+}
+
+void RenderFrame( const MarcherParams& params, MarcherImage& image, TileScheduler& scheduler )
+{
+    scheduler.run( image.width, image.height,
+        std::bind( RenderTile, std::cref(params), std::ref(image), std::placeholders::_1 ) );
+}
+
+void RenderFrame( const MarcherParams& params, MarcherImage& image, unsigned int nbThreads )
+{
+    TileScheduler scheduler( nbThreads );
+    RenderFrame( params, image, scheduler );
+}
+
+}//namespace
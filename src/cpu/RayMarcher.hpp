@@ -0,0 +1,79 @@
+
+#pragma once
+#ifndef CPU_RAYMARCHER_HPP
+#define CPU_RAYMARCHER_HPP
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "cpu/TileScheduler.hpp"
+
+namespace cpu{
+
+// Inputs of the RayMarcher node, with the node's defaults.
+struct MarcherParams
+{
+    MarcherParams()
+    : skyColor(0.9, 1.0, 1.0)
+    , buildingsColor(0.9, 1.0, 1.0)
+    , groundColor(1.0, 1.0, 1.0)
+    , redColor(1.0, 0.1, 0.1)
+    , shadowColor(0.0, 0.3, 0.7)
+    , time(1.0f)
+    , shadowHardness(7.0f)
+    , fovyCoefficient(1.0f)
+    , heatmap(false)
+    , tetrahedronNormals(true)
+    , hitCone(0.0005f)
+    , relaxation(1.2f)
+    , fogCutoff(0.01f)
+    {}
+
+    glm::vec3 skyColor;
+    glm::vec3 buildingsColor;
+    glm::vec3 groundColor;
+    glm::vec3 redColor;
+    glm::vec3 shadowColor;
+    float time;
+    float shadowHardness;
+    float fovyCoefficient;
+    // colors the pixels by the number of marching steps instead of shading
+    bool heatmap;
+    // 4 distance evaluations per normal instead of 6, like the shader's
+    // default (see renderer::SetNormalEstimation)
+    bool tetrahedronNormals;
+    // marching quality, see the RayMarcher node inputs of the same names
+    float hitCone;
+    float relaxation;
+    float fogCutoff;
+};
+
+// The two render targets of the RayMarcher node, bottom row first like GL
+// textures: the shaded color and fragmentInfo (normal*0.5+0.5, distance).
+struct MarcherImage
+{
+    void resize( int w, int h )
+    {
+        width = w;
+        height = h;
+        color.resize( w * h );
+        fragmentInfo.resize( w * h );
+    }
+
+    int width;
+    int height;
+    std::vector<glm::vec4> color;
+    std::vector<glm::vec4> fragmentInfo;
+};
+
+// C++ port of shaders/Raymarching.frag, used to render without a GPU and as
+// a reference to compare the shader against. Rays are marched in packets of
+// four, tile by tile, on all the cores unless nbThreads is given.
+void RenderFrame( const MarcherParams& params, MarcherImage& image, unsigned int nbThreads = 0 );
+
+// Same, reusing the scheduler's threads count and tile size; its stats()
+// then hold the timings of this frame.
+void RenderFrame( const MarcherParams& params, MarcherImage& image, TileScheduler& scheduler );
+
+}//namespace
+
+#endif
@@ -0,0 +1,210 @@
+#include "cpu/TileScheduler.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+namespace cpu{
+
+typedef std::chrono::steady_clock Clock;
+
+static double MillisecondsSince( Clock::time_point start )
+{
+    return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+}
+
+// Range of tile indices [next, end) owned by a thread. Tiles are claimed
+// with fetch_add on next, by the owner or by a thief, so each one is
+// processed exactly once without locks.
+struct TileScheduler::Band
+{
+    std::atomic<int> next;
+    int end;
+    // keep the counters of different threads on different cache lines
+    char padding[64];
+};
+
+// The worker threads wait for the generation to change, process the tiles
+// of the run, and the last one to finish wakes up run().
+struct TileScheduler::Workers
+{
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    unsigned int generation;
+    unsigned int nbRunning;
+    bool quit;
+    const TileFunction * process;
+};
+
+TileScheduler::TileScheduler( unsigned int nbThreads, int tileSize )
+: _tilesX(0), _tilesY(0), _width(0), _height(0), _wallMilliseconds(0.0), _workers(new Workers)
+{
+    _nbThreads = nbThreads != 0 ? nbThreads : std::thread::hardware_concurrency();
+    if( _nbThreads == 0 )
+        _nbThreads = 1;
+    _tileSize = std::max( 4, (tileSize + 3) & ~3 );
+
+    for( unsigned int i = 0; i < _nbThreads; ++i )
+        _bands.push_back( new Band );
+
+    _workers->generation = 0;
+    _workers->nbRunning = 0;
+    _workers->quit = false;
+    _workers->process = 0;
+    for( unsigned int i = 1; i < _nbThreads; ++i )
+        _workers->threads.push_back( std::thread( &TileScheduler::workerLoop, this, i ) );
+}
+
+TileScheduler::~TileScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock( _workers->mutex );
+        _workers->quit = true;
+    }
+    _workers->started.notify_all();
+    for( unsigned int i = 0; i < _workers->threads.size(); ++i )
+        _workers->threads[i].join();
+    delete _workers;
+
+    for( unsigned int i = 0; i < _bands.size(); ++i )
+        delete _bands[i];
+}
+
+void TileScheduler::run( int width, int height, const TileFunction& process )
+{
+    Clock::time_point start = Clock::now();
+
+    _width = width;
+    _height = height;
+    _tilesX = (width + _tileSize - 1) / _tileSize;
+    _tilesY = (height + _tileSize - 1) / _tileSize;
+    int nbTiles = _tilesX * _tilesY;
+    _stats.resize( nbTiles );
+
+    for( unsigned int i = 0; i < _nbThreads; ++i )
+    {
+        _bands[i]->next = (int)( (long long)nbTiles * i / _nbThreads );
+        _bands[i]->end  = (int)( (long long)nbTiles * (i+1) / _nbThreads );
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( _workers->mutex );
+        _workers->process = &process;
+        _workers->nbRunning = _workers->threads.size();
+        ++_workers->generation;
+    }
+    _workers->started.notify_all();
+    work( 0, process );
+
+    {
+        std::unique_lock<std::mutex> lock( _workers->mutex );
+        while( _workers->nbRunning > 0 )
+            _workers->finished.wait( lock );
+        _workers->process = 0;
+    }
+
+    _wallMilliseconds = MillisecondsSince( start );
+}
+
+void TileScheduler::workerLoop( unsigned int thread )
+{
+    unsigned int generation = 0;
+    for(;;)
+    {
+        const TileFunction * process;
+        {
+            std::unique_lock<std::mutex> lock( _workers->mutex );
+            while( !_workers->quit && _workers->generation == generation )
+                _workers->started.wait( lock );
+            if( _workers->quit )
+                return;
+            generation = _workers->generation;
+            process = _workers->process;
+        }
+
+        work( thread, *process );
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock( _workers->mutex );
+            last = --_workers->nbRunning == 0;
+        }
+        if( last )
+            _workers->finished.notify_one();
+    }
+}
+
+void TileScheduler::work( unsigned int thread, const TileFunction& process )
+{
+    // own band first, then the others starting with the next one
+    for( unsigned int b = 0; b < _nbThreads; ++b )
+    {
+        Band& band = *_bands[ (thread + b) % _nbThreads ];
+        for( int index = band.next.fetch_add(1); index < band.end; index = band.next.fetch_add(1) )
+        {
+            Tile tile;
+            tile.x = (index % _tilesX) * _tileSize;
+            tile.y = (index / _tilesX) * _tileSize;
+            tile.width = std::min( _tileSize, _width - tile.x );
+            tile.height = std::min( _tileSize, _height - tile.y );
+
+            Clock::time_point start = Clock::now();
+            process( tile );
+
+            TileStats& stats = _stats[index];
+            stats.tile = tile;
+            stats.milliseconds = MillisecondsSince( start );
+            stats.thread = thread;
+            stats.stolen = b != 0;
+        }
+    }
+}
+
+void TileScheduler::printStats( std::ostream& out ) const
+{
+    if( _stats.empty() )
+        return;
+
+    double total = 0.0;
+    double slowest = 0.0;
+    std::vector<double> busy( _nbThreads, 0.0 );
+    unsigned int stolen = 0;
+    for( unsigned int i = 0; i < _stats.size(); ++i )
+    {
+        total += _stats[i].milliseconds;
+        slowest = std::max( slowest, _stats[i].milliseconds );
+        busy[ _stats[i].thread ] += _stats[i].milliseconds;
+        if( _stats[i].stolen )
+            ++stolen;
+    }
+
+    out << _stats.size() << " tiles of " << _tileSize << "x" << _tileSize
+        << " on " << _nbThreads << " threads: " << _wallMilliseconds << " ms"
+        << " (tiles: " << total << " ms total, " << total / _stats.size() << " ms mean, "
+        << slowest << " ms max, " << stolen << " stolen)\n";
+
+    out << "busy ms per thread:";
+    for( unsigned int i = 0; i < busy.size(); ++i )
+        out << " " << busy[i];
+    out << "\n";
+
+    // top row of the image first; all the tiles are the same when they
+    // were all below the timer resolution
+    static const char shades[] = " .:-=+*#%@";
+    for( int ty = _tilesY - 1; ty >= 0; --ty )
+    {
+        for( int tx = 0; tx < _tilesX; ++tx )
+        {
+            double relative = slowest > 0.0 ? _stats[ ty * _tilesX + tx ].milliseconds / slowest : 0.0;
+            out << shades[ std::min( 9, (int)(relative * 9.0 + 0.5) ) ];
+        }
+        out << "\n";
+    }
+}
+
+}//namespace
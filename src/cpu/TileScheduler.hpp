@@ -0,0 +1,90 @@
+
+#pragma once
+#ifndef CPU_TILESCHEDULER_HPP
+#define CPU_TILESCHEDULER_HPP
+
+#include <vector>
+#include <functional>
+#include <ostream>
+
+namespace cpu{
+
+struct Tile
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+struct TileStats
+{
+    Tile tile;
+    double milliseconds;
+    unsigned int thread;
+    bool stolen;
+};
+
+// Splits an image into square tiles and processes them on all the cores.
+// Each thread starts with a contiguous band of tiles and steals from the
+// other bands once its own is done, which keeps every core busy when the
+// cost per pixel is uneven (sky pixels leave the march early, ground
+// pixels near the horizon use the whole step budget).
+class TileScheduler
+{
+public:
+    typedef std::function<void(const Tile&)> TileFunction;
+
+    // nbThreads = 0 means one per core; the calling thread is one of them.
+    // The tile size is rounded up to a
+    // multiple of 4 so that ray packets never straddle two tiles.
+    TileScheduler( unsigned int nbThreads = 0, int tileSize = 32 );
+    ~TileScheduler();
+
+    void run( int width, int height, const TileFunction& process );
+
+    unsigned int nbThreads() const
+    {
+        return _nbThreads;
+    }
+
+    int tileSize() const
+    {
+        return _tileSize;
+    }
+
+    // Timings of the last run, one entry per tile in row major order.
+    const std::vector<TileStats>& stats() const
+    {
+        return _stats;
+    }
+
+    // Summary of the last run and a map of the relative cost of the tiles.
+    void printStats( std::ostream& out ) const;
+
+private:
+    TileScheduler( const TileScheduler& );
+    TileScheduler& operator=( const TileScheduler& );
+
+    void work( unsigned int thread, const TileFunction& process );
+    void workerLoop( unsigned int thread );
+
+    unsigned int _nbThreads;
+    int _tileSize;
+    int _tilesX;
+    int _tilesY;
+    int _width;
+    int _height;
+    std::vector<TileStats> _stats;
+    double _wallMilliseconds;
+
+    struct Band;
+    std::vector<Band*> _bands;
+    // threads 1 to nbThreads-1, started once and kept between the runs
+    struct Workers;
+    Workers * _workers;
+};
+
+}//namespace
+
+#endif
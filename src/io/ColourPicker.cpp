@@ -7,6 +7,7 @@
 #include <QColorDialog>
 #include "glm/glm.hpp"
 #include "io/ColorNodeView.hpp"
+#include "renderer/NodeSchedule.hpp"
 
 namespace io{
 
@@ -27,6 +28,7 @@ namespace io{
     void ColourPicker::SetColour(const QColor &colour){
         daddy->UpdateGraphics();
         *colourNode->output().dataAs<glm::vec3>() = glm::vec3(colour.red()/255.0, colour.green()/255.0, colour.blue()/255.0);
+        renderer::MarkNodeDirty(colourNode);
     }
 
 }
@@ -0,0 +1,71 @@
+#include "io/NodeMenu.hpp"
+
+#include "io/Compositor.hpp"
+#include "io/NodeView.hpp"
+#include "io/ColorNodeView.hpp"
+
+#include "nodes/PostFxNode.hpp"
+#include "nodes/FloatMathNodes.hpp"
+#include "nodes/ColorNode.hpp"
+#include "nodes/ColorMix.hpp"
+
+#include <iostream>
+
+namespace io{
+
+#define FuncForMenu( create, func ) void func( const QPointF& pos ){ \
+    std::cerr << "add node\n"; \
+io::Compositor::Instance().add( new io::NodeView(pos, create() ) ); \
+}
+
+#define PostFxForMenu( name, func ) void func( const QPointF& pos ){ \
+io::Compositor::Instance().add( new io::NodeView(pos, nodes::CreatePostFxNode(name) ) ); \
+}
+
+#define CompositorAdd( func, name ) io::Compositor::Instance().addNodeToMenu( name, func );
+
+FuncForMenu( nodes::CreateSinNode, AddSinToMenu )
+FuncForMenu( nodes::CreateCosNode, AddCosToMenu )
+FuncForMenu( nodes::CreateClampNode, AddClampToMenu )
+FuncForMenu( nodes::CreateAddNode, AddAddToMenu )
+FuncForMenu( nodes::CreateSubstractNode, AddSubstractToMenu )
+FuncForMenu( nodes::CreateMultiplyNode, AddMultiplyToMenu )
+FuncForMenu( nodes::CreateDivideNode, AddDivideToMenu )
+FuncForMenu( nodes::CreateColorMixNode, AddColorMixToMenu )
+
+PostFxForMenu("Depth of field", AddDofMenu)
+PostFxForMenu("Radial blur", AddRadBlurMenu)
+PostFxForMenu("Edge detection", AddEdgeMenu)
+PostFxForMenu("Black and white", AddbnwMenu)
+PostFxForMenu("Sepia", AddSepiaMenu)
+PostFxForMenu("Bloom", AddBloomMenu)
+PostFxForMenu("Corners", AddCornerMenu)
+
+void AddColorNodeToMenu( const QPointF& p )
+{
+    io::Compositor::Instance().add( new io::ColorNodeView(p, nodes::CreateColorNode() ) );
+}
+
+void AddNodesToMenu()
+{
+    CompositorAdd( &AddSinToMenu, "Sin" );
+    CompositorAdd( &AddCosToMenu, "Cos" );
+    CompositorAdd( &AddAddToMenu, "Add" );
+    CompositorAdd( &AddSubstractToMenu, "Substract" );
+    CompositorAdd( &AddMultiplyToMenu, "Multiply" );
+    CompositorAdd( &AddDivideToMenu, "Divide" );
+    CompositorAdd( &AddClampToMenu, "Clamp" );
+
+    CompositorAdd( &AddColorNodeToMenu, "Color" );
+    CompositorAdd( &AddColorMixToMenu, "ColorMix" );
+
+    CompositorAdd( &AddDofMenu, "Depth of field" );
+    CompositorAdd( &AddRadBlurMenu, "Radial Blur" );
+    CompositorAdd( &AddEdgeMenu, "Edge detection" );
+    CompositorAdd( &AddbnwMenu, "Black and white" );
+    CompositorAdd( &AddSepiaMenu, "Sepia" );
+    CompositorAdd( &AddBloomMenu, "Bloom" );
+    CompositorAdd( &AddCornerMenu, "Corners" );
+}
+
+}//namespace
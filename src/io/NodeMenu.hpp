@@ -0,0 +1,13 @@
+#pragma once
+#ifndef IO_NODEMENU_HPP
+#define IO_NODEMENU_HPP
+
+namespace io{
+
+// Adds the render nodes registered by renderer::InitPipeline to the
+// compositor's context menu.
+void AddNodesToMenu();
+
+}//namespace
+
+#endif
@@ -13,6 +13,9 @@
 #include "io/PortView.hpp"
 #include "io/LinkView.hpp"
 
+#include "renderer/NodeSchedule.hpp"
+#include "renderer/Profiler.hpp"
+
 #include <iostream>
 
 using namespace std;
@@ -56,6 +59,7 @@ NodeView::NodeView( const QPointF& position, kiwi::core::Node * n)
 
 NodeView::~NodeView()
 {
+     renderer::ForgetNode( node() );
      if( scene() ) scene()->removeItem( this );
 }
 
@@ -72,6 +76,20 @@ void NodeView::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 
     painter->setPen( QPen( Qt::gray ) );
     painter->drawText( QRectF(0, 5, _rect.width(), 15), Qt::AlignCenter, nodeName() );
+
+    renderer::NodeTiming timing;
+    if( renderer::GetNodeTiming( node(), timing ) )
+    {
+        QString text = QString("%1 ms").arg( timing.cpuMilliseconds, 0, 'f', 2 );
+        if( timing.gpuMilliseconds >= 0.0 )
+            text += QString(" / gpu %1 ms").arg( timing.gpuMilliseconds, 0, 'f', 2 );
+        QFont font = painter->font();
+        font.setPointSizeF( font.pointSizeF() * 0.75 );
+        painter->save();
+        painter->setFont( font );
+        painter->drawText( QRectF(0, 18, _rect.width(), 12), Qt::AlignCenter, text );
+        painter->restore();
+    }
     painter->setPen( QPen( Qt::black ) );
     for(int i = 0; i < _inputs.size(); ++i )
     {
@@ -175,6 +193,8 @@ void NodeView::outputConnected(kiwi::core::OutputPort* port, kiwi::core::InputPo
 
 void NodeView::inputConnected(kiwi::core::InputPort* port, kiwi::core::OutputPort* to)
 {
+    renderer::InvalidateNodeSchedule();
+
     int in_i = port->index();
     int out_i = to->index();
 
@@ -209,6 +229,8 @@ void NodeView::outputDisconnected(kiwi::core::OutputPort* port, kiwi::core::Inpu
 void NodeView::inputDisconnected(kiwi::core::InputPort* port, kiwi::core::OutputPort* from)
 {
     std::cerr << "ioNodeView::inputDisconnected\n";
+    renderer::InvalidateNodeSchedule();
+
     int in_i = port->index();
     int out_i = from->index();
 
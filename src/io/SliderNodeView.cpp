@@ -12,6 +12,7 @@
 #include <QPainter>
 
 #include "io/SliderNodeAdapter.hpp"
+#include "renderer/NodeSchedule.hpp"
 
 namespace io {
 
@@ -94,6 +95,7 @@ void SliderNodeView::updateValue(int val)
 {
     prepareGeometryChange();
     *node()->output().dataAs<float>() = (float)val * 0.01;
+    renderer::MarkNodeDirty( node() );
 }
 
 }//namespace
@@ -5,7 +5,10 @@
 #include "io/Window.hpp"
 #include "renderer/Renderer.hpp"
 #include "renderer/FrameBuffer.hpp"
+#include "renderer/NodeSchedule.hpp"
+#include "renderer/RenderSize.hpp"
 #include "io/Compositor.hpp"
+#include "utils/CheckGLError.hpp"
 
 
 #include <QApplication>
@@ -106,6 +109,8 @@ void GraphicsScene::contextMenuEvent(QGraphicsSceneContextMenuEvent* e)
       glGetString(GL_VERSION)
     );
 
+    gl_init_error_check();
+
   }
 
 
@@ -113,11 +118,15 @@ void GraphicsScene::contextMenuEvent(QGraphicsSceneContextMenuEvent* e)
   {
     CurrentWidth = Width;
     CurrentHeight = Height;
+    renderer::SetRenderSize(Width, Height);
 
     if (_renderer) {
       _renderer->setWindowDimensions(CurrentWidth, CurrentHeight);
     }
-    renderer::ResizeFrameBuffers(Width,Height);
+    // only reallocates when the size class changes
+    renderer::ResizeFrameBuffers(renderer::GetTargetWidth(), renderer::GetTargetHeight());
+    // the rendered region changed
+    renderer::MarkAllNodesDirty();
     glViewport(0, 0, CurrentWidth, CurrentHeight);
 
   }
@@ -134,6 +143,9 @@ void GraphicsScene::contextMenuEvent(QGraphicsSceneContextMenuEvent* e)
     r->init();
     r->createBuffers();
     _renderer = r;
+
+    connect(&profileClock, SIGNAL(timeout()), Compositor::Instance().scene(), SLOT(update()));
+    profileClock.start(500);
   }
 
 }//namespace
@@ -46,6 +46,8 @@ public:
 protected:
 
       QTimer  redrawClock;
+      // repaints the node timings
+      QTimer  profileClock;
 
       void initializeGL();
       void paintGL();
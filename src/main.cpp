@@ -11,6 +11,9 @@
 #include <assert.h>
 #include "kiwi/core/all.hpp"
 #include "renderer/Shader.hpp"
+#include "renderer/Profiler.hpp"
+#include "renderer/Pipeline.hpp"
+#include "nodes/RayMarchingNode.hpp"
 #include <QApplication>
 #include <QGLFormat>
 #include <QtUiTools>
@@ -43,6 +46,50 @@ int main(int argc, char* argv[])
     InitKiwi();
     QApplication raymarcher( argc, argv );
 
+    // The marcher lowers its resolution when the frames miss the 20 ms
+    // redraw clock of the GLWidget.
+    nodes::SetMarcherFrameBudget( 18.0 );
+    // and only marches half of the pixels each frame
+    nodes::SetMarcherTemporalReprojection( true );
+
+    // --profile prints the node timings every few seconds
+    // --frame-budget <ms> changes the frame time the marcher resolution
+    // adapts to, 0 renders at full resolution
+    // --no-temporal marches every pixel on every frame
+    // --heatmap shows the number of marching steps of each pixel
+    // --normals central uses six-tap normals instead of the tetrahedron
+    // --no-fusion draws every post effect in its own pass
+    // --no-compute uses the fragment shaders of the effects that also have
+    // a compute shader version
+    for( int i = 1; i < argc; ++i )
+    {
+        if( strcmp( argv[i], "--profile" ) == 0 )
+            renderer::SetProfileDumpInterval( 5.0 );
+        else if( strcmp( argv[i], "--frame-budget" ) == 0 && i + 1 < argc )
+            nodes::SetMarcherFrameBudget( atof( argv[++i] ) );
+        else if( strcmp( argv[i], "--no-temporal" ) == 0 )
+            nodes::SetMarcherTemporalReprojection( false );
+        else if( strcmp( argv[i], "--heatmap" ) == 0 )
+            nodes::SetMarcherHeatmap( true );
+        else if( strcmp( argv[i], "--normals" ) == 0 && i + 1 < argc )
+        {
+            const char * mode = argv[++i];
+            if( strcmp( mode, "central" ) == 0 )
+                renderer::SetNormalEstimation( renderer::CENTRAL_DIFFERENCE_NORMALS );
+            else if( strcmp( mode, "tetrahedron" ) == 0 )
+                renderer::SetNormalEstimation( renderer::TETRAHEDRON_NORMALS );
+            else
+            {
+                std::cerr << "--normals expects central or tetrahedron, not " << mode << std::endl;
+                return 1;
+            }
+        }
+        else if( strcmp( argv[i], "--no-fusion" ) == 0 )
+            renderer::SetPostFxFusion( false );
+        else if( strcmp( argv[i], "--no-compute" ) == 0 )
+            renderer::SetComputePostFx( false );
+    }
+
     QGLFormat glFormat;
     glFormat.setVersion( 3, 3 );
     //glFormat.setProfile( QGLFormat::CoreProfile ); // Requires >=Qt-4.8.0
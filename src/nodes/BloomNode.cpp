@@ -0,0 +1,309 @@
+#include "nodes/BloomNode.hpp"
+#include "nodes/PostFxNode.hpp"
+
+#include "renderer/Shader.hpp"
+#include "renderer/DrawQuad.hpp"
+#include "renderer/FrameBuffer.hpp"
+#include "renderer/RenderSize.hpp"
+#include "renderer/FrameData.hpp"
+#include "utils/CheckGLError.hpp"
+
+#include "kiwi/core/all.hpp"
+#include "kiwi/core/NodeUpdater.hpp"
+
+#include "glm/glm.hpp"
+
+#include <iostream>
+#include <vector>
+#include <math.h>
+#include <algorithm>
+#include <map>
+
+using namespace renderer;
+using namespace kiwi;
+using namespace kiwi::core;
+
+
+namespace nodes{
+
+// level 1 is half the resolution of the image, each level half the
+// previous one
+static const int MAX_BLOOM_LEVELS = 6;
+// strength of the single pass version this replaces: the sum of 48 taps
+// weighted by 0.01 * bloomCoefficient (0.48 * coefficient * the average),
+// squared and scaled by 0.0075 to 0.012 depending on the pixel's red,
+// about 0.01
+static const float BLOOM_GAIN = 0.48f * 0.48f * 0.01f;
+
+static renderer::Shader * s_downsampleShader = 0;
+static renderer::Shader * s_blurShader = 0;
+static renderer::Shader * s_compositeShader = 0;
+
+// uniforms of BloomDownsample.frag
+struct DownsampleUniforms
+{
+    Shader::Uniform sourceImage;
+    Shader::Uniform sourceTexelSize;
+    Shader::Uniform sourceRegion;
+};
+static DownsampleUniforms s_downsample;
+
+// uniforms of BloomBlur.frag
+struct BlurUniforms
+{
+    Shader::Uniform sourceImage;
+    Shader::Uniform sourceTexelSize;
+    Shader::Uniform sourceRegion;
+    Shader::Uniform direction;
+    Shader::Uniform coarserImage;
+    Shader::Uniform coarserTexelSize;
+    Shader::Uniform coarserRegion;
+    Shader::Uniform addCoarser;
+};
+static BlurUniforms s_blur;
+
+// uniforms of Bloom.frag
+struct CompositeUniforms
+{
+    Shader::Uniform inputImage;
+    Shader::Uniform bloomImage;
+    Shader::Uniform bloomTexelSize;
+    Shader::Uniform bloomRegion;
+};
+static CompositeUniforms s_composite;
+
+// std140 layout of the BloomParams block of Bloom.frag
+struct BloomParamsBlock
+{
+    GLfloat bloomGain;
+    GLfloat padding[3];
+};
+
+// A level of the pyramid: the downsampled image, which ends up holding the
+// blurred sum of this level and the coarser ones, and the result of the
+// horizontal blur. The levels are shared by all the bloom nodes, which are
+// updated one after the other.
+struct BloomLevel
+{
+    FrameBuffer * image;
+    FrameBuffer * blurred;
+};
+// s_levels[0] is level 1
+static std::vector<BloomLevel> s_levels;
+
+static BloomLevel Level( int level )
+{
+    while( (int)s_levels.size() < level )
+    {
+        // created at the target size, resized with the other render targets
+        int i = s_levels.size() + 1;
+        // only the colour of the levels is used, which is positive
+        FrameBuffer::FormatArray formats( 1, R11G11B10F );
+        BloomLevel l;
+        l.image   = new FrameBuffer( formats, GetTargetWidth(), GetTargetHeight(), false, i );
+        l.blurred = new FrameBuffer( formats, GetTargetWidth(), GetTargetHeight(), false, i );
+        s_levels.push_back( l );
+    }
+    return s_levels[level-1];
+}
+
+// Part of a level's textures holding the image.
+static glm::vec2 LevelRegion( int level )
+{
+    int scale = 1 << level;
+    return glm::vec2( (GetRenderWidth() + scale - 1) / scale, (GetRenderHeight() + scale - 1) / scale );
+}
+
+static glm::vec2 TexelSize( const FrameBuffer* fbo )
+{
+    return glm::vec2( 1.0f / fbo->width(), 1.0f / fbo->height() );
+}
+
+// Each level doubles the size of the glow; a radius of 1 is about the size
+// of the single pass version.
+static int BloomLevels( float radius )
+{
+    int levels = radius > 0.0f ? 2 + (int)ceil( log2( radius ) ) : 1;
+    return std::min( std::max( levels, 1 ), MAX_BLOOM_LEVELS );
+}
+
+template<typename T>
+static T InputOr( const Node& n, int i, const T& defaultValue )
+{
+    return n.input(i).isConnected() ? *n.input(i).dataAs<T>() : defaultValue;
+}
+
+class BloomNodeUpdater : public NodeUpdater
+{
+public:
+    bool update(const Node& n);
+private:
+    void downsample(int level, const Texture2D& source, const glm::vec2& sourceTexelSize);
+    void blur(int level, int nbLevels);
+    std::map<const Node*, NodeParamsBuffer> _params;
+};
+
+bool BloomNodeUpdater::update(const Node& n)
+{
+    if( !n.input(0).isConnected() )
+    {
+        std::cerr << "BloomNodeUpdater::update error! disconnected input\n";
+        return false;
+    }
+    const Texture2D& input = **n.input(0).dataAs<Texture2D*>();
+    FrameBuffer* output = *n.output(0).dataAs<FrameBuffer*>();
+    float coefficient = InputOr( n, 1, 0.0f );
+    int nbLevels = BloomLevels( InputOr( n, 2, 1.0f ) );
+    // without glow the pyramid is not built, the image is copied
+    if( coefficient == 0.0f )
+        nbLevels = 0;
+    CHECKERROR
+
+    // the cost of a level is a quarter of the previous one, so the whole
+    // pyramid costs less than a third of the first level more
+    glm::vec2 inputTexelSize( 1.0f / GetTargetWidth(), 1.0f / GetTargetHeight() );
+    for( int l = 1; l <= nbLevels; ++l )
+    {
+        if( l == 1 )
+            downsample( l, input, inputTexelSize );
+        else
+            downsample( l, Level(l-1).image->texture(0), TexelSize( Level(l-1).image ) );
+    }
+    // coarsest level first, each vertical pass adds the level below
+    for( int l = nbLevels; l >= 1; --l )
+        blur( l, nbLevels );
+
+    output->bind();
+    glViewport( 0, 0, GetRenderWidth(), GetRenderHeight() );
+    s_compositeShader->bind();
+    s_compositeShader->uniform1i( s_composite.inputImage, 0 );
+    s_compositeShader->uniform1i( s_composite.bloomImage, 1 );
+    BloomParamsBlock params = { 0.0f, { 0.0f, 0.0f, 0.0f } };
+    glActiveTexture( GL_TEXTURE0 );
+    input.bind();
+    glActiveTexture( GL_TEXTURE1 );
+    if( nbLevels > 0 )
+    {
+        const FrameBuffer* bloom = Level(1).image;
+        bloom->texture(0).bind();
+        s_compositeShader->uniformVec2( s_composite.bloomTexelSize, TexelSize( bloom ) );
+        s_compositeShader->uniformVec2( s_composite.bloomRegion, LevelRegion(1) );
+        // the levels are added up: their average is the blurred image,
+        // which is squared by the composite
+        params.bloomGain = BLOOM_GAIN * coefficient * coefficient / ( nbLevels * nbLevels );
+    }
+    else
+    {
+        input.bind();
+        s_compositeShader->uniformVec2( s_composite.bloomTexelSize, inputTexelSize );
+        s_compositeShader->uniformVec2( s_composite.bloomRegion, LevelRegion(0) );
+    }
+    _params[&n].update( &params, sizeof(params) );
+    renderer::DrawQuad();
+    glActiveTexture( GL_TEXTURE0 );
+
+    FrameBuffer::unbind();
+    s_compositeShader->unbind();
+    CHECKERROR
+    return true;
+}
+
+void BloomNodeUpdater::downsample(int level, const Texture2D& source, const glm::vec2& sourceTexelSize)
+{
+    BloomLevel l = Level( level );
+    glm::vec2 region = LevelRegion( level );
+    l.image->bind();
+    glViewport( 0, 0, (int)region.x, (int)region.y );
+    s_downsampleShader->bind();
+    s_downsampleShader->uniform1i( s_downsample.sourceImage, 0 );
+    s_downsampleShader->uniformVec2( s_downsample.sourceTexelSize, sourceTexelSize );
+    s_downsampleShader->uniformVec2( s_downsample.sourceRegion, LevelRegion( level-1 ) );
+    glActiveTexture( GL_TEXTURE0 );
+    source.bind();
+    renderer::DrawQuad();
+    CHECKERROR
+}
+
+void BloomNodeUpdater::blur(int level, int nbLevels)
+{
+    BloomLevel l = Level( level );
+    glm::vec2 region = LevelRegion( level );
+    glm::vec2 texelSize = TexelSize( l.image );
+    glViewport( 0, 0, (int)region.x, (int)region.y );
+    s_blurShader->bind();
+    s_blurShader->uniform1i( s_blur.sourceImage, 0 );
+    s_blurShader->uniform1i( s_blur.coarserImage, 1 );
+    s_blurShader->uniformVec2( s_blur.sourceTexelSize, texelSize );
+    s_blurShader->uniformVec2( s_blur.sourceRegion, region );
+
+    // horizontal: image -> blurred
+    l.blurred->bind();
+    s_blurShader->uniformVec2( s_blur.direction, glm::vec2(1.0f, 0.0f) );
+    s_blurShader->uniform1i( s_blur.addCoarser, false );
+    glActiveTexture( GL_TEXTURE0 );
+    l.image->texture(0).bind();
+    renderer::DrawQuad();
+
+    // vertical: blurred (+ coarser level) -> image
+    l.image->bind();
+    s_blurShader->uniformVec2( s_blur.direction, glm::vec2(0.0f, 1.0f) );
+    s_blurShader->uniform1i( s_blur.addCoarser, level < nbLevels );
+    if( level < nbLevels )
+    {
+        const FrameBuffer* coarser = Level( level+1 ).image;
+        s_blurShader->uniformVec2( s_blur.coarserTexelSize, TexelSize( coarser ) );
+        s_blurShader->uniformVec2( s_blur.coarserRegion, LevelRegion( level+1 ) );
+        glActiveTexture( GL_TEXTURE1 );
+        coarser->texture(0).bind();
+    }
+    glActiveTexture( GL_TEXTURE0 );
+    l.blurred->texture(0).bind();
+    renderer::DrawQuad();
+    CHECKERROR
+}
+
+
+void RegisterBloomNode( Shader* downsampleShader, Shader* blurShader, Shader* compositeShader )
+{
+    s_downsampleShader = downsampleShader;
+    s_downsample.sourceImage     = downsampleShader->uniform("sourceImage");
+    s_downsample.sourceTexelSize = downsampleShader->uniform("sourceTexelSize");
+    s_downsample.sourceRegion    = downsampleShader->uniform("sourceRegion");
+
+    s_blurShader = blurShader;
+    s_blur.sourceImage      = blurShader->uniform("sourceImage");
+    s_blur.sourceTexelSize  = blurShader->uniform("sourceTexelSize");
+    s_blur.sourceRegion     = blurShader->uniform("sourceRegion");
+    s_blur.direction        = blurShader->uniform("direction");
+    s_blur.coarserImage     = blurShader->uniform("coarserImage");
+    s_blur.coarserTexelSize = blurShader->uniform("coarserTexelSize");
+    s_blur.coarserRegion    = blurShader->uniform("coarserRegion");
+    s_blur.addCoarser       = blurShader->uniform("addCoarser");
+
+    s_compositeShader = compositeShader;
+    s_composite.inputImage     = compositeShader->uniform("inputImage");
+    s_composite.bloomImage     = compositeShader->uniform("bloomImage");
+    s_composite.bloomTexelSize = compositeShader->uniform("bloomTexelSize");
+    s_composite.bloomRegion    = compositeShader->uniform("bloomRegion");
+
+    auto floatTypeInfo = DataTypeManager::TypeOf("Float");
+    auto textureTypeInfo = DataTypeManager::TypeOf("Texture2D");
+    auto frameBufferTypeInfo = DataTypeManager::TypeOf("FrameBuffer");
+    assert( floatTypeInfo );
+    assert( textureTypeInfo );
+    assert( frameBufferTypeInfo );
+
+    NodeLayoutDescriptor layout;
+    layout.inputs = {
+        {"inputImage", textureTypeInfo, kiwi::READ },
+        {"bloomCoefficient", floatTypeInfo, kiwi::READ },
+        {"bloomRadius", floatTypeInfo, kiwi::READ | OPT }
+    };
+    layout.outputs = {
+        {"fbo", frameBufferTypeInfo, kiwi::READ },
+        {"outputImage", textureTypeInfo, kiwi::READ }
+    };
+    RegisterPostFxNode( "Bloom", layout, new BloomNodeUpdater );
+}
+
+}//namespace
@@ -0,0 +1,20 @@
+#pragma once
+#ifndef NODES_BLOOMNODE_HPP
+#define NODES_BLOOMNODE_HPP
+
+
+namespace renderer{ class Shader; }
+
+namespace nodes{
+
+// The "Bloom" post effect: the bright parts of the image are blurred in a
+// pyramid of downsampled images and added back. downsampleShader builds the
+// levels (shaders/BloomDownsample.frag), blurShader blurs them and adds them
+// up (shaders/BloomBlur.frag), compositeShader adds the result to the image
+// (shaders/Bloom.frag). The nodes are created with CreatePostFxNode("Bloom").
+void RegisterBloomNode( renderer::Shader* downsampleShader, renderer::Shader* blurShader,
+                        renderer::Shader* compositeShader );
+
+}//namespace
+
+#endif
@@ -6,9 +6,6 @@
 #include "kiwi/core/DynamicNodeUpdater.hpp"
 #include "glm/glm.hpp"
 
-#include "io/Compositor.hpp"
-#include "io/NodeView.hpp"
-
 namespace nodes{
 
 typedef kiwi::core::DynamicNodeUpdater::DataArray DataArray;
@@ -23,11 +20,6 @@ bool ApplyColorMix(const DataArray& inputs, const DataArray& outputs)
     return true;
 }
 
-void AddColorMixNodeToScene( const QPointF& p )
-{
-    io::Compositor::Instance().add( new io::NodeView( p, CreateColorMixNode() ) );
-}
-
 void RegisterColorMixNode()
 {
     auto vec3TypeInfo  = kiwi::core::DataTypeManager::TypeOf("Vec3");
@@ -42,7 +34,6 @@ void RegisterColorMixNode()
         { "out", vec3TypeInfo, kiwi::READ }
     };
     kiwi::core::NodeTypeManager::RegisterNode("ColorMix", layout, new kiwi::core::DynamicNodeUpdater( &ApplyColorMix ) );
-    io::Compositor::Instance().addNodeToMenu("ColorMix", &AddColorMixNodeToScene );
 }
 
 kiwi::core::Node * CreateColorMixNode()
@@ -9,7 +9,6 @@ namespace kiwi{ namespace core{ class Node; }}
 
 namespace nodes{
 
-void RegisterColorNode();
 kiwi::core::Node * CreateColorNode( glm::vec3 color );
 kiwi::core::Node * CreateColorNode();
 
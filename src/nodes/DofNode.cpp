@@ -0,0 +1,233 @@
+#include "nodes/DofNode.hpp"
+#include "nodes/PostFxNode.hpp"
+
+#include "renderer/Shader.hpp"
+#include "renderer/DrawQuad.hpp"
+#include "renderer/FrameBuffer.hpp"
+#include "renderer/RenderSize.hpp"
+#include "renderer/FrameData.hpp"
+#include "utils/CheckGLError.hpp"
+
+#include "kiwi/core/all.hpp"
+#include "kiwi/core/NodeUpdater.hpp"
+
+#include "glm/glm.hpp"
+
+#include <iostream>
+#include <map>
+
+using namespace renderer;
+using namespace kiwi;
+using namespace kiwi::core;
+
+
+namespace nodes{
+
+static renderer::Shader * s_prepareShader = 0;
+static renderer::Shader * s_dilateShader = 0;
+static renderer::Shader * s_gatherShader = 0;
+static renderer::Shader * s_compositeShader = 0;
+
+// uniforms of DofPrepare.frag
+struct PrepareUniforms
+{
+    Shader::Uniform inputImage;
+    Shader::Uniform fragmentInfo;
+};
+static PrepareUniforms s_prepare;
+
+// uniforms of DofDilate.frag
+struct DilateUniforms
+{
+    Shader::Uniform sourceImage;
+    Shader::Uniform sourceRegion;
+};
+static DilateUniforms s_dilate;
+
+// uniforms of DofGather.frag
+struct GatherUniforms
+{
+    Shader::Uniform sourceImage;
+    Shader::Uniform sourceTexelSize;
+    Shader::Uniform sourceRegion;
+};
+static GatherUniforms s_gather;
+
+// uniforms of DOF.frag
+struct CompositeUniforms
+{
+    Shader::Uniform inputImage;
+    Shader::Uniform fragmentInfo;
+    Shader::Uniform blurredImage;
+    Shader::Uniform blurredTexelSize;
+    Shader::Uniform blurredRegion;
+};
+static CompositeUniforms s_composite;
+
+// std140 layout of the DofParams block of DofPrepare.frag and DOF.frag
+struct DofParamsBlock
+{
+    GLfloat focalDepth;
+    GLfloat focalRange;
+    GLfloat highlightGain;
+    GLfloat padding;
+};
+
+enum{ FOCAL_DEPTH = 0, FOCAL_RANGE = 1, FRAGMENT_INFO = 2, HIGHLIGHT_GAIN = 3, INPUT_IMAGE = 4 };
+
+// Half resolution targets the passes ping-pong between, shared by all the
+// depth of field nodes, which are updated one after the other.
+static FrameBuffer * s_halfRes[2] = { 0, 0 };
+
+static FrameBuffer * HalfResTarget( int i )
+{
+    if( !s_halfRes[i] )
+    {
+        // created at the target size, resized with the other render targets
+        FrameBuffer::FormatArray formats( 1, RGBA16F );
+        s_halfRes[i] = new FrameBuffer( formats, GetTargetWidth(), GetTargetHeight(), false, 1 );
+    }
+    return s_halfRes[i];
+}
+
+// unconnected floats are 0, as for the single pass effects
+static float FloatInput( const Node& n, int i )
+{
+    return n.input(i).isConnected() ? *n.input(i).dataAs<float>() : 0.0f;
+}
+
+class DofNodeUpdater : public NodeUpdater
+{
+public:
+    bool update(const Node& n);
+private:
+    std::map<const Node*, NodeParamsBuffer> _params;
+};
+
+bool DofNodeUpdater::update(const Node& n)
+{
+    if( !n.input(INPUT_IMAGE).isConnected() || !n.input(FRAGMENT_INFO).isConnected() )
+    {
+        std::cerr << "DofNodeUpdater::update error! disconnected input\n";
+        return false;
+    }
+    const Texture2D& input = **n.input(INPUT_IMAGE).dataAs<Texture2D*>();
+    const Texture2D& fragmentInfo = **n.input(FRAGMENT_INFO).dataAs<Texture2D*>();
+    FrameBuffer* output = *n.output(0).dataAs<FrameBuffer*>();
+    DofParamsBlock params;
+    params.focalDepth    = FloatInput( n, FOCAL_DEPTH );
+    params.focalRange    = FloatInput( n, FOCAL_RANGE );
+    params.highlightGain = FloatInput( n, HIGHLIGHT_GAIN );
+    params.padding = 0.0f;
+    // read by the first and the last pass
+    _params[&n].update( &params, sizeof(params) );
+
+    FrameBuffer* a = HalfResTarget(0);
+    FrameBuffer* b = HalfResTarget(1);
+    glm::vec2 region( (GetRenderWidth() + 1) / 2, (GetRenderHeight() + 1) / 2 );
+    glm::vec2 halfTexelSize( 1.0f / a->width(), 1.0f / a->height() );
+    CHECKERROR
+
+    // circle of confusion and colour -> a
+    a->bind();
+    glViewport( 0, 0, (int)region.x, (int)region.y );
+    s_prepareShader->bind();
+    s_prepareShader->uniform1i( s_prepare.inputImage, 0 );
+    s_prepareShader->uniform1i( s_prepare.fragmentInfo, 1 );
+    glActiveTexture( GL_TEXTURE0 );
+    input.bind();
+    glActiveTexture( GL_TEXTURE1 );
+    fragmentInfo.bind();
+    renderer::DrawQuad();
+
+    // near field dilation a -> b
+    b->bind();
+    s_dilateShader->bind();
+    s_dilateShader->uniform1i( s_dilate.sourceImage, 0 );
+    s_dilateShader->uniformVec2( s_dilate.sourceRegion, region );
+    glActiveTexture( GL_TEXTURE0 );
+    a->texture(0).bind();
+    renderer::DrawQuad();
+
+    // gather b -> a
+    a->bind();
+    s_gatherShader->bind();
+    s_gatherShader->uniform1i( s_gather.sourceImage, 0 );
+    s_gatherShader->uniformVec2( s_gather.sourceTexelSize, halfTexelSize );
+    s_gatherShader->uniformVec2( s_gather.sourceRegion, region );
+    b->texture(0).bind();
+    renderer::DrawQuad();
+    CHECKERROR
+
+    // composite at full resolution
+    output->bind();
+    glViewport( 0, 0, GetRenderWidth(), GetRenderHeight() );
+    s_compositeShader->bind();
+    s_compositeShader->uniform1i( s_composite.inputImage, 0 );
+    s_compositeShader->uniform1i( s_composite.fragmentInfo, 1 );
+    s_compositeShader->uniform1i( s_composite.blurredImage, 2 );
+    s_compositeShader->uniformVec2( s_composite.blurredTexelSize, halfTexelSize );
+    s_compositeShader->uniformVec2( s_composite.blurredRegion, region );
+    glActiveTexture( GL_TEXTURE0 );
+    input.bind();
+    glActiveTexture( GL_TEXTURE1 );
+    fragmentInfo.bind();
+    glActiveTexture( GL_TEXTURE2 );
+    a->texture(0).bind();
+    renderer::DrawQuad();
+    glActiveTexture( GL_TEXTURE0 );
+
+    FrameBuffer::unbind();
+    s_compositeShader->unbind();
+    CHECKERROR
+    return true;
+}
+
+
+void RegisterDofNode( Shader* prepareShader, Shader* dilateShader, Shader* gatherShader, Shader* compositeShader )
+{
+    s_prepareShader = prepareShader;
+    s_prepare.inputImage    = prepareShader->uniform("inputImage");
+    s_prepare.fragmentInfo  = prepareShader->uniform("fragmentInfo");
+
+    s_dilateShader = dilateShader;
+    s_dilate.sourceImage  = dilateShader->uniform("sourceImage");
+    s_dilate.sourceRegion = dilateShader->uniform("sourceRegion");
+
+    s_gatherShader = gatherShader;
+    s_gather.sourceImage     = gatherShader->uniform("sourceImage");
+    s_gather.sourceTexelSize = gatherShader->uniform("sourceTexelSize");
+    s_gather.sourceRegion    = gatherShader->uniform("sourceRegion");
+
+    s_compositeShader = compositeShader;
+    s_composite.inputImage       = compositeShader->uniform("inputImage");
+    s_composite.fragmentInfo     = compositeShader->uniform("fragmentInfo");
+    s_composite.blurredImage     = compositeShader->uniform("blurredImage");
+    s_composite.blurredTexelSize = compositeShader->uniform("blurredTexelSize");
+    s_composite.blurredRegion    = compositeShader->uniform("blurredRegion");
+
+    auto floatTypeInfo = DataTypeManager::TypeOf("Float");
+    auto textureTypeInfo = DataTypeManager::TypeOf("Texture2D");
+    auto frameBufferTypeInfo = DataTypeManager::TypeOf("FrameBuffer");
+    assert( floatTypeInfo );
+    assert( textureTypeInfo );
+    assert( frameBufferTypeInfo );
+
+    // same inputs, in the same order, as the single pass version had
+    NodeLayoutDescriptor layout;
+    layout.inputs = {
+        {"focalDepth", floatTypeInfo, kiwi::READ },
+        {"focalRange", floatTypeInfo, kiwi::READ },
+        {"fragmentInfo", textureTypeInfo, kiwi::READ },
+        {"highlightGain", floatTypeInfo, kiwi::READ },
+        {"inputImage", textureTypeInfo, kiwi::READ }
+    };
+    layout.outputs = {
+        {"fbo", frameBufferTypeInfo, kiwi::READ },
+        {"outputImage", textureTypeInfo, kiwi::READ }
+    };
+    // the composite writes an alpha of 1, which is what R11G11B10F reads
+    RegisterPostFxNode( "Depth of field", layout, new DofNodeUpdater, R11G11B10F );
+}
+
+}//namespace
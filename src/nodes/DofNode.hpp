@@ -0,0 +1,21 @@
+#pragma once
+#ifndef NODES_DOFNODE_HPP
+#define NODES_DOFNODE_HPP
+
+
+namespace renderer{ class Shader; }
+
+namespace nodes{
+
+// The "Depth of field" post effect, blurred at half resolution: the circle
+// of confusion and the colour of each pixel (shaders/DofPrepare.frag), the
+// blur of the foreground spread over its neighbours (shaders/DofDilate.frag),
+// the gather of a fixed disc of samples (shaders/DofGather.frag) and the
+// blend with the full resolution image (shaders/DOF.frag). The nodes are
+// created with CreatePostFxNode("Depth of field").
+void RegisterDofNode( renderer::Shader* prepareShader, renderer::Shader* dilateShader,
+                      renderer::Shader* gatherShader, renderer::Shader* compositeShader );
+
+}//namespace
+
+#endif
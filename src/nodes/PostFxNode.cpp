@@ -6,9 +6,10 @@
 #include "renderer/FrameBuffer.hpp"
 #include "utils/CheckGLError.hpp"
 #include "utils/LoadFile.hpp"
-#include "io/Window.hpp"
-#include "io/Compositor.hpp"
-#include "io/NodeView.hpp"
+#include "renderer/FrameData.hpp"
+#include "renderer/RenderTargetPool.hpp"
+#include "renderer/NodeSchedule.hpp"
+#include "renderer/RenderSize.hpp"
 
 #include "kiwi/core/NodeTypeManager.hpp"
 #include "kiwi/core/DataTypeManager.hpp"
@@ -19,6 +20,11 @@
 #include "kiwi/core/DynamicNodeUpdater.hpp"
 
 #include <iostream>
+#include <vector>
+#include <map>
+#include <stdio.h>
+#include <ctype.h>
+#include <string.h>
 
 using namespace renderer;
 using namespace kiwi::core;
@@ -48,16 +54,57 @@ static GLuint SelectTexture(int i)
 }
 
 
-bool ShaderNodeUpdater::update(const Node& n)
+struct ShaderNodeUpdater::Uniforms
+{
+    std::vector<Shader::Uniform> inputs;
+};
+
+// work group size of the compute versions of the effects
+static const int COMPUTE_TILE_SIZE = 16;
+
+ShaderNodeUpdater::ShaderNodeUpdater( renderer::Shader* shader, const std::string& computeSource )
+: _shader(shader), _uniforms(0), _computeSource(computeSource)
+{
+}
+
+ShaderNodeUpdater::~ShaderNodeUpdater()
+{
+    delete _uniforms;
+    for( auto it = _computeShaders.begin(); it != _computeShaders.end(); ++it )
+        delete it->second;
+}
+
+const ShaderNodeUpdater::Uniforms& ShaderNodeUpdater::uniforms(const Node& n)
+{
+    // every node of the type has the same inputs
+    if( _uniforms == 0 )
+    {
+        _uniforms = new Uniforms;
+        for(int i = 0; i < n.inputs().size(); ++i)
+            _uniforms->inputs.push_back( _shader->uniform(n.input(i).name()) );
+    }
+    return *_uniforms;
+}
+
+// parameter block of each post effect node, see SetInputUniforms
+static std::map<const Node*, NodeParamsBuffer> s_nodeParams;
+
+template<typename T>
+static void SetParam( Shader* shader, Shader::Uniform u, const T& value, std::vector<char>& params )
+{
+    GLint offset = shader->paramOffset(u);
+    if( offset >= 0 && offset + sizeof(T) <= params.size() )
+        memcpy( &params[offset], &value, sizeof(T) );
+}
+
+// Sets the uniforms of the node's inputs, handles[i] being the uniform of
+// input i. Texture inputs are bound to the next texture units, unless
+// bindTextures is false. The values of the PARAM inputs are written to
+// params, laid out as the shader's parameter block, to be uploaded with
+// the node's NodeParamsBuffer.
+static bool SetInputUniforms( Shader* shader, const std::vector<Shader::Uniform>& handles,
+                              const Node& n, std::vector<char>& params, bool bindTextures = true )
 {
-    CHECKERROR
-    (*n.output(0).dataAs<FrameBuffer*>())->bind();
-    CHECKERROR
-    _shader->bind();
-    CHECKERROR
-    if(_shader->hasLocation("windowSize"))
-        _shader->uniform2f("windowSize", io::GetRenderWindowWidth(), io::GetRenderWindowHeight() );
-    CHECKERROR
     int nbTex = 0;
 
     for(int i = 0; i < n.inputs().size(); ++i)
@@ -68,11 +115,12 @@ bool ShaderNodeUpdater::update(const Node& n)
             if( !n.input(i).isConnected() )
             {
                 std::cerr << "ShadeNodeUpdate::update error! disconnected input\n";
-                FrameBuffer::unbind();
                 return false;
             }
+            if( !bindTextures )
+                continue;
             CHECKERROR
-            _shader->uniform1i(n.input(i).name(), nbTex);
+            shader->uniform1i(handles[i], nbTex);
             glActiveTexture( SelectTexture(nbTex) );
             (*n.input(i).dataAs<Texture2D*>())->bind();
             //std::cerr << "uniform texture " << n.input(i).name() << " -> "<< nbTex << std::endl;
@@ -84,29 +132,59 @@ bool ShaderNodeUpdater::update(const Node& n)
             if( !n.input(i).isConnected() )
             {
                 std::cerr << "ShadeNodeUpdate::update error! disconnected input\n";
-                FrameBuffer::unbind();
                 return false;
             }
             CHECKERROR
-            _shader->uniformVec3(n.input(i).name(), *n.input(i).dataAs<glm::vec3>() );
+            if( shader->isParam(handles[i]) )
+                SetParam( shader, handles[i], *n.input(i).dataAs<glm::vec3>(), params );
+            else
+                shader->uniformVec3(handles[i], *n.input(i).dataAs<glm::vec3>() );
             //std::cerr << "uniform vec3" << n.input(i).name() << std::endl;
             CHECKERROR
         }
         else if ( n.input(i).dataType() == floatTypeInfo )
         {
-            if( !n.input(i).isConnected() )
-            {
-                _shader->uniform1f(n.input(i).name(), 0 );
-            }
+            float value = n.input(i).isConnected() ? *n.input(i).dataAs<float>() : 0.0f;
+            CHECKERROR
+            //std::cerr << "uniform float " << n.input(i).name() << std::endl;
+            if( shader->isParam(handles[i]) )
+                SetParam( shader, handles[i], value, params );
             else
-            {
-                CHECKERROR
-                //std::cerr << "uniform float " << n.input(i).name() << std::endl;
-                _shader->uniform1f(n.input(i).name(), *n.input(i).dataAs<float>() );
-                CHECKERROR
-            }
+                shader->uniform1f(handles[i], value );
+            CHECKERROR
         }
     }
+    return true;
+}
+
+bool ShaderNodeUpdater::update(const Node& n)
+{
+    const Uniforms& u = uniforms(n);
+    if( !_computeSource.empty() )
+    {
+        FrameBuffer * output = *n.output(0).dataAs<FrameBuffer*>();
+        Shader * compute = computeShader( output->format(0) );
+        CHECKERROR
+        if( compute->bind() )
+            return dispatch(n, u, compute);
+        // the errors were printed when it was finished
+        std::cerr << "ShaderNodeUpdater error! the compute shader is not valid, "
+                  << "using the fragment shader" << std::endl;
+        _computeSource.clear();
+    }
+    CHECKERROR
+    (*n.output(0).dataAs<FrameBuffer*>())->bind();
+    CHECKERROR
+    _shader->bind();
+    CHECKERROR
+    std::vector<char> params( _shader->paramsSize(), 0 );
+    if( !SetInputUniforms( _shader, u.inputs, n, params ) )
+    {
+        FrameBuffer::unbind();
+        return false;
+    }
+    if( !params.empty() )
+        s_nodeParams[&n].update( &params[0], params.size() );
 
     CHECKERROR
     renderer::DrawQuad();
@@ -117,9 +195,53 @@ bool ShaderNodeUpdater::update(const Node& n)
     return true;
 }
 
+Shader * ShaderNodeUpdater::computeShader( TextureFormat format )
+{
+    auto it = _computeShaders.find( format );
+    if( it != _computeShaders.end() )
+        return it->second;
+
+    // same locations as the fragment shader, so that the uniform handles
+    // of the inputs are valid for both
+    Shader::LocationMap locations( _shader->locations_begin(), _shader->locations_end() );
+    std::string define = std::string("#define OUTPUT_FORMAT ") + ImageFormatQualifier( format );
+    Shader * shader = new Shader;
+    shader->compileCompute( InsertDefines( _computeSource, define ), locations );
+    _computeShaders[format] = shader;
+    return shader;
+}
 
-void RegisterPostFxNode( renderer::Shader* shader, const std::string& name )
+bool ShaderNodeUpdater::dispatch(const Node& n, const Uniforms& u, Shader * shader)
 {
+    FrameBuffer * output = *n.output(0).dataAs<FrameBuffer*>();
+    std::vector<char> params( shader->paramsSize(), 0 );
+    if( !SetInputUniforms( shader, u.inputs, n, params ) )
+        return false;
+    if( !params.empty() )
+        s_nodeParams[&n].update( &params[0], params.size() );
+
+    glBindImageTexture( 0, output->texture(0).id(), 0, GL_FALSE, 0, GL_WRITE_ONLY, InternalFormat( output->format(0) ) );
+    glDispatchCompute( ( GetRenderWidth() + COMPUTE_TILE_SIZE - 1 ) / COMPUTE_TILE_SIZE,
+                       ( GetRenderHeight() + COMPUTE_TILE_SIZE - 1 ) / COMPUTE_TILE_SIZE, 1 );
+    // the next passes sample the output or read it through its frame buffer
+    glMemoryBarrier( GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT );
+    CHECKERROR
+    shader->unbind();
+    return true;
+}
+
+
+static std::map<std::string, TextureFormat> s_outputFormats;
+// shaders of the single pass effects, by name
+static std::map<std::string, Shader*> s_postFxShaders;
+// type of the nodes created with CreatePostFxNode
+static std::map<const Node*, std::string> s_postFxNodes;
+
+void RegisterPostFxNode( renderer::Shader* shader, const std::string& name, TextureFormat format,
+                         const std::string& computeSource )
+{
+    s_outputFormats[name] = format;
+    s_postFxShaders[name] = shader;
     auto fboTypeInfo = DataTypeManager::TypeOf("FrameBuffer");
     textureTypeInfo = DataTypeManager::TypeOf("Texture2D");
     vec3TypeInfo = DataTypeManager::TypeOf("Vec3");
@@ -140,15 +262,22 @@ void RegisterPostFxNode( renderer::Shader* shader, const std::string& name )
                 break;
             }
             case (Shader::UNIFORM | Shader::FLOAT3) :
+            case (Shader::UNIFORM | Shader::PARAM | Shader::FLOAT3) :
             {
                 info = vec3TypeInfo;
                 break;
             }
             case (Shader::UNIFORM | Shader::FLOAT) :
+            case (Shader::UNIFORM | Shader::PARAM | Shader::FLOAT) :
             {
                 info = floatTypeInfo;
                 break;
             }
+            case Shader::BLOCK :
+            {
+                // not an input, bound by the renderer
+                break;
+            }
             default:
             {
                 std::cerr << "ignored location " << it->first << std::endl;
@@ -162,57 +291,349 @@ void RegisterPostFxNode( renderer::Shader* shader, const std::string& name )
         {"fbo", fboTypeInfo, kiwi::READ },
         {"outputImage", textureTypeInfo, kiwi::READ }
     };
-    NodeTypeManager::RegisterNode(name, layout, new ShaderNodeUpdater( shader ) );
+    if( !computeSource.empty() && !ComputeShadersSupported() )
+    {
+        std::cout << name << ": no compute shaders, using the fragment shader" << std::endl;
+        NodeTypeManager::RegisterNode(name, layout, new ShaderNodeUpdater( shader ) );
+    }
+    else
+        NodeTypeManager::RegisterNode(name, layout, new ShaderNodeUpdater( shader, computeSource ) );
+}
+
+void RegisterPostFxNode( const std::string& name, const NodeLayoutDescriptor& layout,
+                         NodeUpdater* updater, TextureFormat format )
+{
+    s_outputFormats[name] = format;
+    NodeTypeManager::RegisterNode(name, layout, updater );
 }
 
 
 kiwi::core::Node * CreatePostFxNode(const std::string& name)
 {
     auto node = kiwi::core::NodeTypeManager::TypeOf(name)->newInstance();
+    s_postFxNodes[node] = name;
 
-    // create output resources (for render to texture)
-    // Port 0 : frame buffer
-    // Port 1 : texture (attached to the fbo)
+    // the frame buffer (port 0) and its texture (port 1) are drawn from the
+    // render target pool when the node is scheduled
+    renderer::SetPooledRenderTarget( node, s_outputFormats[name] );
 
-    auto fbo = new FrameBuffer(1,io::GetRenderWindowWidth(),io::GetRenderWindowHeight());
-    *node->output(0).dataAs<FrameBuffer*>() = fbo;
+    return node;
+}
 
-    assert( *node->output(0).dataAs<FrameBuffer*>() == fbo );
 
-    *node->output(1).dataAs<Texture2D*>() = &fbo->texture(0);
 
-    return node;
+// ---------------------------------------------------------------- Point-wise effects fusion
+
+
+static const char * POINTWISE_BEGIN = "// BEGIN POINTWISE";
+static const char * POINTWISE_END = "// END POINTWISE";
+
+// The section of a point-wise effect's fragment shader and the names it
+// declares, which get a suffix per position in the fused shader.
+struct PointwiseEffect
+{
+    std::string section;
+    std::vector<std::string> names;
+};
+static std::map<std::string, PointwiseEffect> s_pointwiseEffects;
+
+static std::string s_postFxVertexShader;
+
+// A generated shader, and the shader of the effect of each of its stages
+// with the uniforms of its inputs. The parameter block of stage i is bound
+// to NODE_PARAMS_BINDING + i, with the layout of the effect's own shader.
+struct FusedShader
+{
+    Shader * shader;
+    Shader::Uniform inputImage;
+    std::vector<Shader*> stageShaders;
+    std::vector< std::vector<Shader::Uniform> > stageInputs;
+};
+// each stage has its own parameter block, and GL 3.3 only guarantees 12
+// blocks per fragment shader, FrameData included
+static const unsigned int MAX_FUSED_STAGES = 8;
+// by chain signature (the effect names)
+static std::map<std::string, FusedShader> s_fusedShaders;
+// by last node of the chain
+static std::map<const Node*, const FusedShader*> s_fusedChains;
+
+// Functions are declared at the start of a line, "type name(".
+static void FindFunctionNames( const std::string& section, std::vector<std::string>& names )
+{
+    size_t lineStart = 0;
+    while( lineStart < section.size() )
+    {
+        size_t lineEnd = section.find( '\n', lineStart );
+        if( lineEnd == std::string::npos )
+            lineEnd = section.size();
+        std::string line = section.substr( lineStart, lineEnd - lineStart );
+        size_t paren = line.find( '(' );
+        size_t assignment = line.find( '=' );
+        if( !line.empty() && isalpha( line[0] ) && line.compare( 0, 8, "uniform " ) != 0
+            && paren != std::string::npos && paren > 0
+            && ( assignment == std::string::npos || assignment > paren ) )
+        {
+            size_t end = line.find_last_not_of( " \t", paren - 1 );
+            size_t begin = end;
+            while( begin > 0 && ( isalnum( line[begin-1] ) || line[begin-1] == '_' ) )
+                --begin;
+            // at least the type before the name
+            if( begin > 0 )
+                names.push_back( line.substr( begin, end + 1 - begin ) );
+        }
+        lineStart = lineEnd + 1;
+    }
+}
+
+bool RegisterPointwiseEffect( const std::string& name, const std::string& fragmentSource )
+{
+    size_t begin = fragmentSource.find( POINTWISE_BEGIN );
+    size_t end = fragmentSource.find( POINTWISE_END );
+    auto shader = s_postFxShaders.find( name );
+    if( begin == std::string::npos || end == std::string::npos || end < begin
+        || shader == s_postFxShaders.end() )
+    {
+        std::cerr << "RegisterPointwiseEffect error! no point-wise section in " << name << std::endl;
+        return false;
+    }
+    begin = fragmentSource.find( '\n', begin ) + 1;
+
+    PointwiseEffect effect;
+    effect.section = fragmentSource.substr( begin, end - begin );
+    FindFunctionNames( effect.section, effect.names );
+    // the parameters and their block, but not the image and the blocks
+    // shared by every stage
+    for( auto it = shader->second->locations_begin(); it != shader->second->locations_end(); ++it )
+    {
+        int type = it->second.type;
+        if( type == Shader::BLOCK && it->second.location == NODE_PARAMS_BINDING )
+            effect.names.push_back( it->first );
+        else if( ( type & Shader::UNIFORM ) && type != ( Shader::UNIFORM | Shader::TEXTURE2D ) )
+        {
+            // plain uniforms would have to be set on the fused shader
+            if( !( type & Shader::PARAM ) )
+            {
+                std::cerr << "RegisterPointwiseEffect error! " << it->first << " of " << name
+                          << " is not in the parameter block" << std::endl;
+                return false;
+            }
+            effect.names.push_back( it->first );
+        }
+    }
+    s_pointwiseEffects[name] = effect;
+    return true;
+}
+
+static std::string Suffixed( const std::string& name, unsigned int stage )
+{
+    char suffix[16];
+    snprintf( suffix, sizeof(suffix), "_%u", stage );
+    return name + suffix;
 }
 
+// Each stage is the section of its effect with the declared names
+// suffixed by the stage number, and main runs the stages in order:
+//
+//     #define Effect Effect_0
+//     #define factor factor_0
+//     #define NodeParams NodeParams_0
+//     layout(std140) uniform NodeParams { float factor; };
+//     vec4 Effect( in vec4 color ) { ... }
+//     #undef Effect
+//     #undef factor
+//     #undef NodeParams
+//     ...
+//     out_Color = Effect_1( Effect_0( texture(inputImage, ...) ) );
+static std::string GenerateFusedShader( const std::vector<std::string>& effects )
+{
+    std::string source =
+        "#version 330\n"
+        "// generated by nodes/PostFxNode.cpp from:";
+    for( unsigned int i = 0; i < effects.size(); ++i )
+        source += " " + effects[i];
+    source += "\n\n"
+        "out vec4 out_Color;\n"
+        "\n"
+        "uniform sampler2D inputImage;\n"
+        "\n"
+        "layout(std140) uniform FrameData\n"
+        "{\n"
+        "    vec2 windowSize;\n"
+        "    vec2 texelSize;\n"
+        "    float frameTime;\n"
+        "};\n";
+
+    std::string color = "texture(inputImage, gl_FragCoord.xy * texelSize)";
+    for( unsigned int i = 0; i < effects.size(); ++i )
+    {
+        const PointwiseEffect& effect = s_pointwiseEffects[ effects[i] ];
+        source += "\n";
+        for( unsigned int n = 0; n < effect.names.size(); ++n )
+            source += "#define " + effect.names[n] + " " + Suffixed( effect.names[n], i ) + "\n";
+        source += effect.section;
+        for( unsigned int n = 0; n < effect.names.size(); ++n )
+            source += "#undef " + effect.names[n] + "\n";
+        color = Suffixed( "Effect", i ) + "( " + color + " )";
+    }
+
+    source += "\n"
+        "void main(void)\n"
+        "{\n"
+        "    out_Color = " + color + ";\n"
+        "}\n";
+    return source;
+}
+
+class PostFxChainFuser : public NodeChainFuser
+{
+public:
+    unsigned int maxChainSize() const
+    {
+        return MAX_FUSED_STAGES;
+    }
+
+    bool canFuse( const Node * n )
+    {
+        auto type = s_postFxNodes.find( n );
+        return type != s_postFxNodes.end()
+            && s_pointwiseEffects.find( type->second ) != s_pointwiseEffects.end();
+    }
+
+    bool fuse( const Chain& chain );
+    bool update( const Chain& chain );
+
+    void clear()
+    {
+        s_fusedChains.clear();
+    }
+};
+
+bool PostFxChainFuser::fuse( const Chain& chain )
+{
+    if( chain.size() > MAX_FUSED_STAGES )
+        return false;
+
+    std::vector<std::string> effects;
+    std::string signature;
+    for( unsigned int i = 0; i < chain.size(); ++i )
+    {
+        effects.push_back( s_postFxNodes[ chain[i] ] );
+        signature += effects.back() + "|";
+    }
+
+    auto it = s_fusedShaders.find( signature );
+    if( it == s_fusedShaders.end() )
+    {
+        Shader::LocationMap locations = {
+            {"inputImage",  { Shader::UNIFORM | Shader::TEXTURE2D} },
+            {"FrameData",   { Shader::BLOCK, FRAME_DATA_BINDING } }
+        };
+        for( unsigned int i = 0; i < effects.size(); ++i )
+        {
+            Shader * single = s_postFxShaders[ effects[i] ];
+            for( auto loc = single->locations_begin(); loc != single->locations_end(); ++loc )
+            {
+                if( loc->second.type == Shader::BLOCK && loc->second.location == NODE_PARAMS_BINDING )
+                    locations[ Suffixed( loc->first, i ) ] = Shader::Location( Shader::BLOCK, NODE_PARAMS_BINDING + i );
+            }
+        }
 
+        FusedShader fused;
+        fused.shader = new Shader;
+        fused.shader->compile( s_postFxVertexShader, GenerateFusedShader( effects ), locations );
+        // finished right away: if it does not compile or link, the chain is
+        // not fused, and the signature is remembered so that it is not
+        // built again
+        if( !fused.shader->finish() )
+        {
+            std::cerr << "PostFxChainFuser error! could not build the fused shader for " << signature
+                      << ", the effects are drawn in separate passes" << std::endl;
+            delete fused.shader;
+            fused.shader = 0;
+            s_fusedShaders[signature] = fused;
+            return false;
+        }
+        std::cout << "fused post effects " << signature << std::endl;
 
-#define FuncForMenu( name, func ) void func( const QPointF& pos ){ \
-io::Compositor::Instance().add( new io::NodeView(pos, CreatePostFxNode(name) ) ); \
+        // the input image of the first stage is the chain's; the other
+        // stages read the previous one. The parameters are packed with the
+        // layout of the effects' shaders, which must be finished for that.
+        fused.inputImage = fused.shader->uniform( "inputImage" );
+        for( unsigned int i = 0; i < chain.size(); ++i )
+        {
+            Shader * single = s_postFxShaders[ effects[i] ];
+            single->finish();
+            std::vector<Shader::Uniform> inputs;
+            for( int p = 0; p < chain[i]->inputs().size(); ++p )
+                inputs.push_back( single->uniform( chain[i]->input(p).name() ) );
+            fused.stageShaders.push_back( single );
+            fused.stageInputs.push_back( inputs );
+        }
+        it = s_fusedShaders.insert( std::make_pair( signature, fused ) ).first;
+    }
+
+    if( !it->second.shader )
+        return false;
+
+    s_fusedChains[ chain.back() ] = &it->second;
+    return true;
+}
+
+bool PostFxChainFuser::update( const Chain& chain )
+{
+    const FusedShader& fused = *s_fusedChains[ chain.back() ];
+    CHECKERROR
+    (*chain.back()->output(0).dataAs<FrameBuffer*>())->bind();
+    fused.shader->bind();
+    for( unsigned int i = 0; i < chain.size(); ++i )
+    {
+        // the textures are not bound, only the parameters are packed
+        Shader * single = fused.stageShaders[i];
+        std::vector<char> params( single->paramsSize(), 0 );
+        if( !SetInputUniforms( single, fused.stageInputs[i], *chain[i], params, false ) )
+        {
+            FrameBuffer::unbind();
+            return false;
+        }
+        if( !params.empty() )
+            s_nodeParams[ chain[i] ].update( &params[0], params.size(), NODE_PARAMS_BINDING + i );
+    }
+    for( int p = 0; p < chain[0]->inputs().size(); ++p )
+    {
+        if( chain[0]->input(p).dataType() == textureTypeInfo )
+        {
+            fused.shader->uniform1i( fused.inputImage, 0 );
+            glActiveTexture( GL_TEXTURE0 );
+            (*chain[0]->input(p).dataAs<Texture2D*>())->bind();
+        }
+    }
+    renderer::DrawQuad();
+    CHECKERROR
+    FrameBuffer::unbind();
+    fused.shader->unbind();
+    return true;
 }
 
-FuncForMenu("Depth of field", AddDofMenu)
-FuncForMenu("Radial blur", AddRadBlurMenu)
-FuncForMenu("Edge detection", AddEdgeMenu)
-FuncForMenu("Black and White", AddbnwMenu)
-FuncForMenu("Sepia", AddSepiaMenu)
-FuncForMenu("Bloom", AddBloomMenu)
-FuncForMenu("Corners", AddCornerMenu)
+static PostFxChainFuser s_chainFuser;
 
-void AddPostFxToMenu()
+void EnablePostFxFusion( const std::string& vertexSource, bool enabled )
 {
-  io::Compositor::Instance().addNodeToMenu( "Depth of field", &AddDofMenu );
-  io::Compositor::Instance().addNodeToMenu( "Radial Blur", &AddRadBlurMenu );
-  io::Compositor::Instance().addNodeToMenu( "Edge detection", &AddEdgeMenu );
-  io::Compositor::Instance().addNodeToMenu( "Black and white", &AddbnwMenu );
-  io::Compositor::Instance().addNodeToMenu( "Sepia", &AddSepiaMenu );
-  io::Compositor::Instance().addNodeToMenu( "Bloom", &AddBloomMenu );
-  io::Compositor::Instance().addNodeToMenu( "Corners", &AddCornerMenu );
+    s_postFxVertexShader = vertexSource;
+    renderer::SetNodeChainFuser( enabled ? &s_chainFuser : 0 );
 }
 
+unsigned int GetNbFusedChains()
+{
+    return s_fusedChains.size();
+}
+
+
+
 // ---------------------------------------------------------------- Render to screen
 
 
 static renderer::Shader * s_renderToScreenShader = 0;
+static Shader::Uniform s_screenInputImage;
 
 typedef DynamicNodeUpdater::DataArray DataArray;
 bool RenderToScreen(const DataArray& inputs, const DataArray&)
@@ -223,8 +644,7 @@ bool RenderToScreen(const DataArray& inputs, const DataArray&)
     auto inputTex = *inputs[0]->value<Texture2D*>();
     assert(inputTex);
 
-    s_renderToScreenShader->uniform1i("inputImage",0);
-    s_renderToScreenShader->uniform2f("windowSize", io::GetRenderWindowWidth(), io::GetRenderWindowHeight());
+    s_renderToScreenShader->uniform1i(s_screenInputImage,0);
 
     glActiveTexture(GL_TEXTURE0);
     inputTex->bind();
@@ -244,9 +664,10 @@ void RegisterScreenNode()
 
     renderer::Shader::LocationMap locations = {
         {"inputImage",   { Shader::UNIFORM | Shader::TEXTURE2D} },
-        {"windowSize",   { Shader::UNIFORM | Shader::FLOAT2} }
+        {"FrameData",    { Shader::BLOCK, FRAME_DATA_BINDING } }
     };
-    s_renderToScreenShader->build(vs,fs,locations);
+    s_renderToScreenShader->compile(vs,fs,locations);
+    s_screenInputImage = s_renderToScreenShader->uniform("inputImage");
 
     NodeLayoutDescriptor layout;
     layout.inputs = {
@@ -258,7 +679,9 @@ void RegisterScreenNode()
 
 kiwi::core::Node * CreateScreenNode()
 {
-    return NodeTypeManager::Create("Screen");
+    auto node = NodeTypeManager::Create("Screen");
+    renderer::SetDisplayNode( node );
+    return node;
 }
 
 }//namespace
@@ -4,7 +4,10 @@
 #define NODES_POSTFXNODE_HPP
 
 #include <string>
+#include <map>
 #include "kiwi/core/NodeUpdater.hpp"
+#include "kiwi/core/NodeTypeManager.hpp"
+#include "renderer/TextureFormat.hpp"
 
 namespace kiwi{ namespace core{ class Node; }}
 
@@ -17,21 +20,75 @@ class ShaderNodeUpdater : public kiwi::core::NodeUpdater
 {
 public:
 
-    ShaderNodeUpdater( renderer::Shader* shader )
-    : _shader(shader) { }
+    // With a compute source, the effect is drawn by that compute shader
+    // instead of the fragment shader, see RegisterPostFxNode.
+    ShaderNodeUpdater( renderer::Shader* shader, const std::string& computeSource = "" );
+    ~ShaderNodeUpdater();
 
     bool update(const kiwi::core::Node& n);
 
 private:
+    // uniform handles of the inputs, resolved on the first update
+    struct Uniforms;
+    const Uniforms& uniforms(const kiwi::core::Node& n);
+
+    // shader is the compute shader, already bound
+    bool dispatch(const kiwi::core::Node& n, const Uniforms& u, renderer::Shader * shader);
+    renderer::Shader * computeShader( renderer::TextureFormat format );
+
     renderer::Shader * _shader;
+    Uniforms * _uniforms;
+    std::string _computeSource;
+    // built on first use for each format of render target the output is
+    // written to
+    std::map<renderer::TextureFormat, renderer::Shader*> _computeShaders;
 };
 
 
-void AddPostFxToMenu();
-
-void RegisterPostFxNode( renderer::Shader* shader, const std::string& name );
+// format is the storage the effect's output needs; it is demoted to RGBA8
+// when only the screen reads it.
+//
+// The node's inputs are the shader's texture, float and vec3 uniforms. The
+// float and vec3 ones are better declared as Shader::PARAM members of a
+// std140 block bound to NODE_PARAMS_BINDING (see renderer/FrameData.hpp):
+// each node then has its own buffer for them, uploaded only when its
+// inputs change.
+//
+// computeSource is an optional compute shader (GL 4.3) doing the same work
+// as the fragment shader in tiles, with the same uniforms. It writes the
+// output to the image2D at binding 0, whose format qualifier is
+// OUTPUT_FORMAT, and runs in 16x16 work groups. When it is given and the
+// context supports compute shaders, it replaces the fragment shader;
+// otherwise, or if it fails to build, the effect runs as a fragment pass as
+// usual.
+void RegisterPostFxNode( renderer::Shader* shader, const std::string& name,
+                         renderer::TextureFormat format = renderer::RGBA16F,
+                         const std::string& computeSource = "" );
+// Effects that need more than one pass bring their own updater. Their
+// outputs are the same as the single pass effects (the frame buffer and its
+// texture), and they are created with CreatePostFxNode as well.
+void RegisterPostFxNode( const std::string& name, const kiwi::core::NodeLayoutDescriptor& layout,
+                         kiwi::core::NodeUpdater* updater, renderer::TextureFormat format = renderer::RGBA16F );
 kiwi::core::Node * CreatePostFxNode( const std::string& name );
 
+// Point-wise effects: each output pixel only depends on the same input
+// pixel. Their fragment shader has a section between "// BEGIN POINTWISE"
+// and "// END POINTWISE" lines declaring their parameter block (all their
+// float and vec3 inputs must be in it) and a
+// vec4 Effect( in vec4 color ) function, which may read gl_FragCoord and the
+// FrameData block but no texture. The effect must be registered with
+// RegisterPostFxNode first.
+bool RegisterPointwiseEffect( const std::string& name, const std::string& fragmentSource );
+
+// Chains of point-wise effect nodes (each reading the previous one only)
+// are then drawn in a single pass by a shader generated from their
+// sections, one per chain signature; see renderer/NodeSchedule.hpp.
+// vertexSource is the vertex shader of the post effects.
+void EnablePostFxFusion( const std::string& vertexSource, bool enabled = true );
+
+// Number of chains drawn with a fused shader.
+unsigned int GetNbFusedChains();
+
 void RegisterScreenNode();
 kiwi::core::Node * CreateScreenNode();
 
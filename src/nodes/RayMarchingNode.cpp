@@ -5,14 +5,20 @@
 #include "renderer/DrawQuad.hpp"
 #include "renderer/FrameBuffer.hpp"
 #include "utils/CheckGLError.hpp"
-#include "io/Window.hpp"
+#include "renderer/FrameData.hpp"
+#include "renderer/RenderSize.hpp"
+#include "renderer/Profiler.hpp"
 #include "kiwi/core/all.hpp"
-#include "kiwi/core/DynamicNodeUpdater.hpp"
+#include "kiwi/core/NodeUpdater.hpp"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
 #include <iostream>
+#include <map>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
 
 using namespace renderer;
 using namespace kiwi;
@@ -24,11 +30,202 @@ namespace nodes{
 
 static const NodeTypeInfo * _marcherTypeInfo = 0;
 static renderer::Shader * _raymarchingShader = 0;
+static Shader::Uniform s_marcherHeatmap;
+static renderer::Shader * _upscaleShader = 0;
+static Shader::Uniform s_upscaleInputImage;
+static Shader::Uniform s_upscaleFragmentInfo;
+static Shader::Uniform s_upscaleRenderScale;
+static renderer::Shader * _resolveShader = 0;
+
+// uniforms of TemporalResolve.frag
+struct ResolveUniforms
+{
+    Shader::Uniform marchedImage;
+    Shader::Uniform marchedInfo;
+    Shader::Uniform historyImage;
+    Shader::Uniform historyInfo;
+    Shader::Uniform historyValid;
+    Shader::Uniform parity;
+    Shader::Uniform regionSize;
+    Shader::Uniform historyRegionSize;
+    Shader::Uniform cameraPosition;
+    Shader::Uniform historyCameraPosition;
+    Shader::Uniform fovyCoefficient;
+};
+static ResolveUniforms s_resolve;
 
 enum{ FBO_INDEX = 0, TEX0_INDEX = 1, TEX1_INDEX=2 };
 
-typedef DynamicNodeUpdater::DataArray DataArray;
-bool RayMarcherNodeUpdate(const DataArray& inputs, const DataArray& outputs)
+// std140 layout of the MarcherParams block in Raymarching.frag
+struct MarcherParamsBlock
+{
+    glm::mat4 viewMatrix;
+    glm::vec3 shadowColor;
+    GLfloat time;
+    glm::vec3 buildingsColor;
+    GLfloat shadowHardness;
+    glm::vec3 groundColor;
+    GLfloat fovyCoefficient;
+    glm::vec3 redColor;
+    GLfloat renderScale;
+    glm::vec3 skyColor;
+    GLfloat checkerboard;
+    GLfloat hitCone;
+    GLfloat relaxation;
+    GLfloat fogCutoff;
+    GLfloat padding;
+};
+static_assert( sizeof(MarcherParamsBlock) == 160, "MarcherParamsBlock must match the std140 layout" );
+
+// uniform buffer of a marcher node and the values it holds, the target it
+// renders to when the render scale is below 1, and the targets of the
+// temporal reprojection
+struct MarcherNodeData
+{
+    GLuint paramsBuffer;
+    MarcherParamsBlock uploaded;
+    FrameBuffer* lowRes;
+    // pixels marched this frame, half as wide as the region
+    FrameBuffer* checker;
+    // copy of the last resolved frame and what it was rendered with
+    FrameBuffer* history;
+    bool historyValid;
+    MarcherParamsBlock historyParams;
+    glm::vec2 historyRegion;
+    glm::vec2 historyWindow;
+    unsigned int frameIndex;
+};
+
+class RayMarcherNodeUpdater : public NodeUpdater
+{
+public:
+    bool update(const Node& n);
+private:
+    void march(FrameBuffer* target, float width, float height);
+    void resolve(MarcherNodeData& data, FrameBuffer* target, const glm::vec2& region);
+    std::map<const Node*, MarcherNodeData> _nodes;
+};
+
+// ---------------------------------------------------------------- Dynamic resolution
+
+// the render scale moves by steps of RENDER_SCALE_STEP between
+// MIN_RENDER_SCALE and 1
+static const float MIN_RENDER_SCALE = 0.5f;
+static const float RENDER_SCALE_STEP = 1.0f / 16.0f;
+
+static double s_frameBudget = 0.0;
+// shared by all the marchers, since they share the frame time
+static float s_renderScale = 1.0f;
+// frames to wait after a change, until the averaged frame time reflects
+// the new scale
+static int s_settleFrames = 0;
+// the frame the scale was last updated for, so that it changes once per
+// frame however many marchers there are
+static unsigned int s_scaleFrame = (unsigned int)-1;
+
+void SetMarcherFrameBudget( double milliseconds )
+{
+    s_frameBudget = milliseconds;
+    s_renderScale = 1.0f;
+    s_settleFrames = 0;
+}
+
+float GetMarcherRenderScale()
+{
+    return s_renderScale;
+}
+
+static void UpdateRenderScale()
+{
+    if( s_frameBudget <= 0.0 || s_scaleFrame == GetFrameCount() )
+        return;
+    s_scaleFrame = GetFrameCount();
+    if( s_settleFrames > 0 )
+    {
+        --s_settleFrames;
+        return;
+    }
+
+    FrameTiming timing;
+    if( !GetFrameTiming( timing ) )
+        return;
+    double ms = timing.gpuMilliseconds >= 0.0 ? timing.gpuMilliseconds : timing.cpuMilliseconds;
+    if( ms <= 0.0 )
+        return;
+
+    float scale = s_renderScale;
+    if( ms > s_frameBudget )
+    {
+        // the marching cost is about proportional to the number of pixels
+        scale *= sqrt( s_frameBudget / ms );
+        scale = floor( scale / RENDER_SCALE_STEP ) * RENDER_SCALE_STEP;
+    }
+    else if( ms < s_frameBudget * 0.75 )
+    {
+        scale += RENDER_SCALE_STEP;
+    }
+    scale = std::min( std::max( scale, MIN_RENDER_SCALE ), 1.0f );
+
+    if( scale != s_renderScale )
+    {
+        s_renderScale = scale;
+        s_settleFrames = PROFILE_HISTORY;
+    }
+}
+
+// ---------------------------------------------------------------- Temporal reprojection
+
+static bool s_temporal = false;
+
+// history older than that (in time units, one per frame with the timer
+// node) is not reused
+static const float MAX_HISTORY_AGE = 4.0f;
+
+void SetMarcherTemporalReprojection( bool enabled )
+{
+    s_temporal = enabled;
+}
+
+// camera position in FishEyeCamera
+static glm::vec3 CameraPosition( float time )
+{
+    return glm::vec3( 5.0f * sin(time * 0.01f), 25.0f, time );
+}
+
+// true if the two blocks only differ by the values that change from frame
+// to frame
+static bool SameScene( MarcherParamsBlock a, MarcherParamsBlock b )
+{
+    a.time = b.time = 0.0f;
+    a.renderScale = b.renderScale = 0.0f;
+    a.checkerboard = b.checkerboard = 0.0f;
+    return memcmp( &a, &b, sizeof(a) ) == 0;
+}
+
+static FrameBuffer* CreateTargetLike( const FrameBuffer* fbo )
+{
+    FrameBuffer::FormatArray formats = { fbo->format(0), fbo->format(1) };
+    return new FrameBuffer( formats, fbo->width(), fbo->height(), false );
+}
+
+// ---------------------------------------------------------------- Step heatmap
+
+static bool s_heatmap = false;
+
+void SetMarcherHeatmap( bool enabled )
+{
+    s_heatmap = enabled;
+}
+
+// ---------------------------------------------------------------- Marcher node
+
+template<typename T>
+static T InputOr( const Node& n, int i, const T& defaultValue )
+{
+    return n.input(i).isConnected() ? *n.input(i).dataAs<T>() : defaultValue;
+}
+
+bool RayMarcherNodeUpdater::update(const Node& n)
 {
     if(_raymarchingShader == 0)
     {
@@ -36,63 +233,189 @@ bool RayMarcherNodeUpdate(const DataArray& inputs, const DataArray& outputs)
         return false;
     }
 
-    auto viewMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -5.f));
-    float time = 1.0;
+    UpdateRenderScale();
 
-    (*outputs[FBO_INDEX]->value<FrameBuffer*>())->bind();
-
-    _raymarchingShader->bind();
-    
-    if ( inputs[0] ){
-        CHECKERROR
-        _raymarchingShader->uniformVec3("skyColor", *inputs[0]->value<glm::vec3>() );
-        CHECKERROR
-    } else _raymarchingShader->uniform3f("skyColor", 0.9, 1.0, 1.0 );
-
-    if ( inputs[1] ){
-        _raymarchingShader->uniformVec3("buildingsColor", *inputs[1]->value<glm::vec3>() );
-    } else _raymarchingShader->uniform3f("buildingsColor", 0.9, 1.0, 1.0 );
-
-    if ( inputs[2] ){
-        _raymarchingShader->uniformVec3("groundColor", *inputs[2]->value<glm::vec3>() );
-    } else _raymarchingShader->uniform3f("groundColor", 1.0, 1.0, 1.0 );
-
-    if ( inputs[3] ){
-        _raymarchingShader->uniformVec3("redColor", *inputs[3]->value<glm::vec3>() );
-    } else _raymarchingShader->uniform3f("redColor", 1.0, 0.1, 0.1 );
-    
-    if ( inputs[4] ){
-        _raymarchingShader->uniformVec3("shadowColor", *inputs[4]->value<glm::vec3>() );
-    } else _raymarchingShader->uniform3f("shadowColor", 0.0, 0.3, 0.7 );
+    auto it = _nodes.find(&n);
+    if( it == _nodes.end() )
+    {
+        MarcherNodeData data;
+        glGenBuffers( 1, &data.paramsBuffer );
+        glBindBuffer( GL_UNIFORM_BUFFER, data.paramsBuffer );
+        glBufferData( GL_UNIFORM_BUFFER, sizeof(MarcherParamsBlock), 0, GL_DYNAMIC_DRAW );
+        data.lowRes = 0;
+        data.checker = 0;
+        data.history = 0;
+        data.historyValid = false;
+        data.frameIndex = 0;
+        it = _nodes.insert( std::make_pair(&n, data) ).first;
+    }
 
-    if ( inputs[5] ){
-        _raymarchingShader->uniformMatrix4fv("viewMatrix", &(*inputs[5]->value<glm::mat4>())[0][0] );
-    } else _raymarchingShader->uniformMatrix4fv("viewMatrix", &viewMatrix[0][0] );
+    MarcherParamsBlock params;
+    params.renderScale = s_renderScale;
+    // the parity of the checkerboard alternates every frame, the half of
+    // the AO samples every other frame
+    params.checkerboard = s_temporal ? (float)(it->second.frameIndex % 4) : -1.0f;
+    params.skyColor        = InputOr( n, 0, glm::vec3(0.9, 1.0, 1.0) );
+    params.buildingsColor  = InputOr( n, 1, glm::vec3(0.9, 1.0, 1.0) );
+    params.groundColor     = InputOr( n, 2, glm::vec3(1.0, 1.0, 1.0) );
+    params.redColor        = InputOr( n, 3, glm::vec3(1.0, 0.1, 0.1) );
+    params.shadowColor     = InputOr( n, 4, glm::vec3(0.0, 0.3, 0.7) );
+    params.viewMatrix      = InputOr( n, 5, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -5.f)) );
+    params.time            = InputOr( n, 6, 1.0f );
+    params.shadowHardness  = InputOr( n, 7, 7.0f );
+    params.fovyCoefficient = InputOr( n, 8, 1.0f );
+    params.hitCone         = InputOr( n, 9, 0.0005f );
+    params.relaxation      = InputOr( n, 10, 1.2f );
+    params.fogCutoff       = InputOr( n, 11, 0.01f );
+    params.padding = 0.0f;
+
+    // nothing was uploaded before the first frame
+    if( it->second.frameIndex == 0 || memcmp( &params, &it->second.uploaded, sizeof(params) ) != 0 )
+    {
+        glBindBuffer( GL_UNIFORM_BUFFER, it->second.paramsBuffer );
+        glBufferSubData( GL_UNIFORM_BUFFER, 0, sizeof(params), &params );
+        it->second.uploaded = params;
+    }
+    glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+    glBindBufferBase( GL_UNIFORM_BUFFER, NODE_PARAMS_BINDING, it->second.paramsBuffer );
+    CHECKERROR
+
+    FrameBuffer* output = *n.output(FBO_INDEX).dataAs<FrameBuffer*>();
+    MarcherNodeData& data = it->second;
+    int w = GetRenderWidth();
+    int h = GetRenderHeight();
+    glm::vec2 region( w * params.renderScale, h * params.renderScale );
+
+    // below scale 1 the marcher renders in the lower left part of the
+    // region, and its output is upscaled
+    FrameBuffer* target = output;
+    if( params.renderScale < 1.0f )
+    {
+        if( !data.lowRes )
+            data.lowRes = CreateTargetLike( output );
+        target = data.lowRes;
+    }
 
-    if ( inputs[6] ){
-        _raymarchingShader->uniform1f("time", *inputs[6]->value<GLfloat>() );
-    } else _raymarchingShader->uniform1f("time", time);
+    if( params.checkerboard >= 0.0f )
+    {
+        if( !data.checker )
+            data.checker = CreateTargetLike( output );
+        march( data.checker, ceil(region.x * 0.5f), region.y );
+        resolve( data, target, region );
+        data.historyParams = params;
+        data.historyRegion = region;
+        data.historyWindow = glm::vec2( w, h );
+    }
+    else
+    {
+        march( target, region.x, region.y );
+        data.historyValid = false;
+    }
+    ++data.frameIndex;
+    glViewport( 0, 0, w, h );
+    CHECKERROR
 
-    if ( inputs[7] ){
-        _raymarchingShader->uniform1f("shadowHardness", *inputs[7]->value<GLfloat>() );
-    } else _raymarchingShader->uniform1f("shadowHardness", 7.0f );
+    if( target != output )
+    {
+        output->bind();
+        _upscaleShader->bind();
+        _upscaleShader->uniform1i( s_upscaleInputImage, 0 );
+        _upscaleShader->uniform1i( s_upscaleFragmentInfo, 1 );
+        _upscaleShader->uniform1f( s_upscaleRenderScale, params.renderScale );
+        glActiveTexture( GL_TEXTURE0 );
+        target->texture(0).bind();
+        glActiveTexture( GL_TEXTURE1 );
+        target->texture(1).bind();
+        renderer::DrawQuad();
+        glActiveTexture( GL_TEXTURE0 );
+    }
 
-    if ( inputs[8] ){
-        _raymarchingShader->uniform1f("fovyCoefficient", *inputs[8]->value<GLfloat>() );
-    } else _raymarchingShader->uniform1f("fovyCoefficient", 1.0 );
+    FrameBuffer::unbind();
+    CHECKERROR
+    return true;
+}
 
-    _raymarchingShader->uniform2f("windowSize", io::GetRenderWindowWidth(), io::GetRenderWindowHeight() );
+void RayMarcherNodeUpdater::march(FrameBuffer* target, float width, float height)
+{
+    target->bind();
+    glViewport( 0, 0, (int)ceil(width), (int)ceil(height) );
+    _raymarchingShader->bind();
+    _raymarchingShader->uniform1i( s_marcherHeatmap, s_heatmap );
+    renderer::DrawQuad();
+}
 
+void RayMarcherNodeUpdater::resolve(MarcherNodeData& data, FrameBuffer* target, const glm::vec2& region)
+{
+    const MarcherParamsBlock& params = data.uploaded;
+    bool historyValid = data.history
+                     && data.historyValid
+                     && data.historyWindow == glm::vec2( GetRenderWidth(), GetRenderHeight() )
+                     && fabs( params.time - data.historyParams.time ) <= MAX_HISTORY_AGE
+                     && SameScene( params, data.historyParams );
+    if( !data.history )
+        data.history = CreateTargetLike( target );
+
+    target->bind();
+    glViewport( 0, 0, (int)ceil(region.x), (int)ceil(region.y) );
+    _resolveShader->bind();
+    _resolveShader->uniform1i( s_resolve.marchedImage, 0 );
+    _resolveShader->uniform1i( s_resolve.marchedInfo, 1 );
+    _resolveShader->uniform1i( s_resolve.historyImage, 2 );
+    _resolveShader->uniform1i( s_resolve.historyInfo, 3 );
+    _resolveShader->uniform1i( s_resolve.historyValid, historyValid );
+    _resolveShader->uniform1f( s_resolve.parity, fmod( params.checkerboard, 2.0f ) );
+    _resolveShader->uniformVec2( s_resolve.regionSize, region );
+    _resolveShader->uniformVec2( s_resolve.historyRegionSize, data.historyRegion );
+    _resolveShader->uniformVec3( s_resolve.cameraPosition, CameraPosition( params.time ) );
+    _resolveShader->uniformVec3( s_resolve.historyCameraPosition, CameraPosition( data.historyParams.time ) );
+    _resolveShader->uniform1f( s_resolve.fovyCoefficient, params.fovyCoefficient );
+    glActiveTexture( GL_TEXTURE0 );
+    data.checker->texture(0).bind();
+    glActiveTexture( GL_TEXTURE1 );
+    data.checker->texture(1).bind();
+    glActiveTexture( GL_TEXTURE2 );
+    data.history->texture(0).bind();
+    glActiveTexture( GL_TEXTURE3 );
+    data.history->texture(1).bind();
     renderer::DrawQuad();
+    CHECKERROR
 
-    FrameBuffer::unbind();
-    return true;
+    // keeps the resolved frame for the next one
+    glBindFramebuffer( GL_READ_FRAMEBUFFER, target->id() );
+    for( int i = 0; i < 2; ++i )
+    {
+        glReadBuffer( GL_COLOR_ATTACHMENT0 + i );
+        glActiveTexture( GL_TEXTURE0 );
+        data.history->texture(i).bind();
+        glCopyTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, 0, 0, (int)ceil(region.x), (int)ceil(region.y) );
+    }
+    glReadBuffer( GL_COLOR_ATTACHMENT0 );
+    glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+    data.historyValid = true;
+    CHECKERROR
 }
 
 
-void RegisterRayMarchingNode( Shader * shader )
+void RegisterRayMarchingNode( Shader * shader, Shader * upscaleShader, Shader * resolveShader )
 {
     _raymarchingShader = shader;
+    s_marcherHeatmap = shader->uniform("heatmap");
+    _upscaleShader = upscaleShader;
+    s_upscaleInputImage = upscaleShader->uniform("inputImage");
+    s_upscaleFragmentInfo = upscaleShader->uniform("fragmentInfo");
+    s_upscaleRenderScale = upscaleShader->uniform("renderScale");
+    _resolveShader = resolveShader;
+    s_resolve.marchedImage          = resolveShader->uniform("marchedImage");
+    s_resolve.marchedInfo           = resolveShader->uniform("marchedInfo");
+    s_resolve.historyImage          = resolveShader->uniform("historyImage");
+    s_resolve.historyInfo           = resolveShader->uniform("historyInfo");
+    s_resolve.historyValid          = resolveShader->uniform("historyValid");
+    s_resolve.parity                = resolveShader->uniform("parity");
+    s_resolve.regionSize            = resolveShader->uniform("regionSize");
+    s_resolve.historyRegionSize     = resolveShader->uniform("historyRegionSize");
+    s_resolve.cameraPosition        = resolveShader->uniform("cameraPosition");
+    s_resolve.historyCameraPosition = resolveShader->uniform("historyCameraPosition");
+    s_resolve.fovyCoefficient       = resolveShader->uniform("fovyCoefficient");
     //RegisterShaderNode("RayMarcher", *raymarchingShader );
     auto mat4TypeInfo = kiwi::core::DataTypeManager::TypeOf("Mat4");
     auto floatTypeInfo = kiwi::core::DataTypeManager::TypeOf("Float");
@@ -117,7 +440,10 @@ void RegisterRayMarchingNode( Shader * shader )
         {"viewMatrix", mat4TypeInfo, kiwi::READ | OPT },
         {"time", floatTypeInfo, kiwi::READ | OPT },
         {"shadowHardness", floatTypeInfo, kiwi::READ | OPT },
-        {"fovyCoefficient", floatTypeInfo, kiwi::READ | OPT }
+        {"fovyCoefficient", floatTypeInfo, kiwi::READ | OPT },
+        {"hitCone", floatTypeInfo, kiwi::READ | OPT },
+        {"relaxation", floatTypeInfo, kiwi::READ | OPT },
+        {"fogCutoff", floatTypeInfo, kiwi::READ | OPT }
     };
     raymacherLayout.outputs = {
         {"fbo", frameBufferTypeInfo, kiwi::READ },
@@ -125,7 +451,7 @@ void RegisterRayMarchingNode( Shader * shader )
         {"fragmentInfos", textureTypeInfo, kiwi::READ }
     };
 
-    _marcherTypeInfo = NodeTypeManager::RegisterNode("RayMarcher", raymacherLayout, new DynamicNodeUpdater( &RayMarcherNodeUpdate ) );
+    _marcherTypeInfo = NodeTypeManager::RegisterNode("RayMarcher", raymacherLayout, new RayMarcherNodeUpdater );
 
 }
 
@@ -134,7 +460,7 @@ Node * CreateRayMarchingNode()
 {
     auto node = _marcherTypeInfo->newInstance();
 
-    assert(node->inputs().size() == 9 );
+    assert(node->inputs().size() == 12 );
     assert(node->outputs().size() == 3 );
 
     assert(node->input(0).dataType() == kiwi::core::DataTypeManager::TypeOf("Vec3") );
@@ -142,7 +468,14 @@ Node * CreateRayMarchingNode()
     assert(node->input(2).dataType() == kiwi::core::DataTypeManager::TypeOf("Vec3") );
     assert(node->input(3).dataType() == kiwi::core::DataTypeManager::TypeOf("Vec3") );
 
-    auto fbo = new FrameBuffer(2,400,400);
+    // colour in half floats; the fragment infos need full floats for the
+    // depth (sky pixels are 1e7 away, past the range of half floats)
+    FrameBuffer::FormatArray formats = { renderer::RGBA16F, renderer::RGBA32F };
+    // the size is not known yet when the pipeline is created before the
+    // first resize
+    int w = renderer::GetTargetWidth() > 0 ? renderer::GetTargetWidth() : 400;
+    int h = renderer::GetTargetHeight() > 0 ? renderer::GetTargetHeight() : 400;
+    auto fbo = new FrameBuffer(formats,w,h);
     *node->output(0).dataAs<FrameBuffer*>() = fbo;
     
     assert( *node->output(0).dataAs<FrameBuffer*>() == fbo );
@@ -10,9 +10,28 @@ namespace renderer{ class Shader; }
 
 namespace nodes {
 
-void RegisterRayMarchingNode( renderer::Shader* shader );
+// upscaleShader brings the output back to full resolution when the
+// marcher renders at a lower scale, see shaders/Upscale.frag. resolveShader
+// is the temporal reprojection, see shaders/TemporalResolve.frag.
+void RegisterRayMarchingNode( renderer::Shader* shader, renderer::Shader* upscaleShader, renderer::Shader* resolveShader );
 kiwi::core::Node * CreateRayMarchingNode();
 
+// Dynamic resolution: the marchers render at a scale between 0.5 and 1,
+// lowered when the frames take longer than the budget and raised when they
+// are well below it. 0 (the default) disables it and renders at full
+// resolution.
+void SetMarcherFrameBudget( double milliseconds );
+float GetMarcherRenderScale();
+
+// Temporal reprojection: the marchers only march half of the pixels each
+// frame, in a checkerboard, and fill the other half by reprojecting the
+// previous frame with the depth of the neighbours. Disabled by default.
+void SetMarcherTemporalReprojection( bool enabled );
+
+// Colors the pixels by the number of marching steps of their ray, from blue
+// (none) to red (MAX_STEPS), instead of shading them.
+void SetMarcherHeatmap( bool enabled );
+
 } //namespace
 
 
@@ -2,6 +2,8 @@
 #include "nodes/TimeNode.hpp"
 #include "kiwi/core/all.hpp"
 #include "kiwi/core/DynamicNodeUpdater.hpp"
+#include "renderer/NodeSchedule.hpp"
+#include "renderer/FrameData.hpp"
 #include <assert.h>
 #include <GL/glew.h>
 
@@ -17,6 +19,8 @@ typedef DynamicNodeUpdater::DataArray DataArray;
 bool TimerNodeUpdate(const DataArray& inputs, const DataArray& outputs)
 {
     *outputs[0]->value<GLfloat>() += 1;
+    renderer::SetFrameTime( *outputs[0]->value<GLfloat>() );
+    return true;
 }
 
 void RegisterTimeNode()
@@ -37,7 +41,10 @@ Node * CreateTimeNode()
 {
     assert( _nodeTypeInfo != 0 );
 
-    return _nodeTypeInfo->newInstance();
+    auto node = _nodeTypeInfo->newInstance();
+    // the timer ticks at every update, it can't be cached
+    renderer::SetNodeVolatile( node );
+    return node;
 }
 
 
@@ -4,6 +4,7 @@
 #include <iostream>
 #include "utils/CheckGLError.hpp"
 #include <vector>
+#include <algorithm>
 
 using namespace std;
 
@@ -49,20 +50,35 @@ GLenum getGLColorAttachement( int i )
     return 0;
 }
 
-FrameBuffer::FrameBuffer( int nbTextures, int fbwidth, int fbheight)
+static int LevelSize( int size, int level )
+{
+    return std::max( size >> level, 1 );
+}
+
+FrameBuffer::FrameBuffer( int nbTextures, int fbwidth, int fbheight, bool depth)
+: _hasDepth(depth), _level(0), _formats(nbTextures, RGBA32F)
+{
+    AddFrameBuffer(this);
+    init(fbwidth,fbheight);
+}
+
+FrameBuffer::FrameBuffer( const FormatArray& formats, int fbwidth, int fbheight, bool depth, int level)
+: _hasDepth(depth), _level(level), _formats(formats)
 {
     AddFrameBuffer(this);
-    init(nbTextures,fbwidth,fbheight);
+    init(fbwidth,fbheight);
 }
 
-void FrameBuffer::init( int nbTextures, int fbwidth, int fbheight)
+void FrameBuffer::init( int fbwidth, int fbheight)
 {
+    int nbTextures = _formats.size();
     cout << "FrameBuffer::init("<< nbTextures <<", "<< fbwidth << ", "<<fbheight <<")"<< endl;
 
     _nbTex = nbTextures;
     _textures.clear();
     CHECKERROR
-    for( int i = 0; i < nbTextures+1; ++i)
+    int nbAllocated = _hasDepth ? nbTextures+1 : nbTextures;
+    for( int i = 0; i < nbAllocated; ++i)
     {
         _textures.push_back( new Texture2D );
         glBindTexture( GL_TEXTURE_2D, _textures[i]->id() );
@@ -70,11 +86,8 @@ void FrameBuffer::init( int nbTextures, int fbwidth, int fbheight)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        if ( i == nbTextures ) // depth texture
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, fbwidth, fbheight, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, NULL);
-        else
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, fbwidth, fbheight, 0, GL_RGBA, GL_FLOAT, 0);
     }
+    allocate( LevelSize(fbwidth, _level), LevelSize(fbheight, _level) );
     CHECKERROR
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_UNSUPPORTED)
     {
@@ -84,18 +97,18 @@ void FrameBuffer::init( int nbTextures, int fbwidth, int fbheight)
         std::cout << "Framebuffer Binded! ID: " << _id << std::endl;
         CHECKERROR
         //  Binging Textures to the Framebuffer
-        GLenum* attachements = new GLenum[_textures.size()-1];
-        for( int i = 0; i < _textures.size()-1; ++i )
+        std::vector<GLenum> attachements(_nbTex);
+        for( int i = 0; i < _nbTex; ++i )
         {
             glFramebufferTexture2D(GL_FRAMEBUFFER, getGLColorAttachement(i), GL_TEXTURE_2D, _textures[i]->id(), 0);
             attachements[i] = getGLColorAttachement(i);
         }
         CHECKERROR
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _textures[_textures.size()-1]->id(), 0);
+        if( _hasDepth )
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _textures[_nbTex]->id(), 0);
         CHECKERROR
-        glDrawBuffers(_textures.size()-1, &attachements[0]);
+        glDrawBuffers(_nbTex, &attachements[0]);
         CHECKERROR
-        delete[] attachements;
 
         if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         {
@@ -111,6 +124,22 @@ void FrameBuffer::init( int nbTextures, int fbwidth, int fbheight)
 
 }
 
+void FrameBuffer::allocate( int w, int h )
+{
+    for( int i = 0; i < _textures.size(); ++i)
+    {
+        glBindTexture( GL_TEXTURE_2D, _textures[i]->id() );
+        if ( i == _nbTex ) // depth texture
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, w, h, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, NULL);
+        else
+            glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat(_formats[i]), w, h, 0, PixelFormat(_formats[i]), PixelType(_formats[i]), 0);
+    }
+    Texture2D::unbind();
+    _width = w;
+    _height = h;
+    CHECKERROR
+}
+
 void FrameBuffer::destroy()
 {
      for( int i = 0; i < _textures.size(); ++i )
@@ -122,43 +151,14 @@ void FrameBuffer::destroy()
 
 void FrameBuffer::resize(int w, int h)
 {
-    //destroy();
-    //init(_nbTex,w,h);
-    //
-    cout << "resize " << w <<" "<<h<<endl;
-    glDeleteFramebuffers(1, &_id);
-    glGenFramebuffers(1, &_id);
-    glBindFramebuffer(GL_FRAMEBUFFER, _id);
-    for( int i = 0; i < _textures.size(); ++i)
-    {
-        //GLuint oldTexId = _textures[i]->id();
-        //glDeleteTextures(1, &oldTexId );
-        Texture2D::unbind();
-        _textures[i]->regenerate();
-        glBindTexture( GL_TEXTURE_2D, _textures[i]->id() );
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        if ( i == _textures.size()-1 ) // depth texture
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, w, h, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, NULL);
-        else
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, w, h, 0, GL_RGBA, GL_FLOAT, 0);
-
-        GLenum* attachements = new GLenum[_textures.size()-1];
-        for( int i = 0; i < _textures.size()-1; ++i )
-        {
-            glFramebufferTexture2D(GL_FRAMEBUFFER, getGLColorAttachement(i), GL_TEXTURE_2D, _textures[i]->id(), 0);
-            attachements[i] = getGLColorAttachement(i);
-        }
-
-        CHECKERROR
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _textures[_textures.size()-1]->id(), 0);
-        CHECKERROR
-        glDrawBuffers(_textures.size()-1, &attachements[0]);
-        CHECKERROR
-    }
-    CHECKERROR
+    w = LevelSize(w, _level);
+    h = LevelSize(h, _level);
+    if( w == _width && h == _height )
+        return;
+
+    // The textures and the FBO are kept, only their storage is
+    // re-specified: the attachments stay valid.
+    allocate(w, h);
 }
 
 FrameBuffer::~FrameBuffer()
@@ -6,6 +6,7 @@
 #include <GL/glew.h>
 #include <vector>
 #include "renderer/Texture.hpp"
+#include "renderer/TextureFormat.hpp"
 
 namespace renderer{
 
@@ -16,7 +17,15 @@ void ResizeFrameBuffers(int w, int h);
 class FrameBuffer{
 public:
     typedef std::vector<Texture2D*> TextureArray; 
-    FrameBuffer( int nbTextures, int fbwidth, int fbheight );
+    typedef std::vector<TextureFormat> FormatArray;
+
+    // nbTextures RGBA32F colour attachments, plus a depth texture after
+    // them if depth is true.
+    FrameBuffer( int nbTextures, int fbwidth, int fbheight, bool depth = true );
+    // One colour attachment per format. The textures of a level n buffer
+    // are 2^n times smaller than the size it is given (and resized to), for
+    // the passes working on downsampled images.
+    FrameBuffer( const FormatArray& formats, int fbwidth, int fbheight, bool depth = true, int level = 0 );
     ~FrameBuffer();
 
     GLuint id() const
@@ -39,13 +48,42 @@ public:
         return *_textures[i];
     }
 
+    TextureFormat format(int i) const
+    {
+        return _formats[i];
+    }
+
+    // Allocated size of the textures.
+    int width() const
+    {
+        return _width;
+    }
+
+    int height() const
+    {
+        return _height;
+    }
+
+    int level() const
+    {
+        return _level;
+    }
+
+    // Re-specifies the storage of the textures if the size changed. The
+    // texture and FBO ids stay the same.
     void resize(int w, int h);
 private:
-    void init(int nbTextures, int fbwidth, int fbheight);
+    void init(int fbwidth, int fbheight);
+    void allocate(int w, int h);
     void destroy();
 
     GLuint _nbTex;
+    bool _hasDepth;
+    int _level;
+    FormatArray _formats;
     GLuint _id;
+    int _width;
+    int _height;
     TextureArray _textures;
 };
 
@@ -0,0 +1,98 @@
+#include <GL/glew.h>
+
+#include "renderer/FrameData.hpp"
+#include "renderer/RenderSize.hpp"
+#include "utils/CheckGLError.hpp"
+
+#include <string.h>
+
+namespace renderer{
+
+// std140 layout of the FrameData block in the shaders
+struct FrameDataBlock
+{
+    GLfloat windowSize[2];
+    GLfloat texelSize[2];
+    GLfloat frameTime;
+    GLfloat padding[3];
+};
+
+static GLuint s_frameDataBuffer = 0;
+static FrameDataBlock s_current;
+static FrameDataBlock s_uploaded;
+static bool s_needsUpload = true;
+
+void InitFrameData()
+{
+    memset( &s_current, 0, sizeof(s_current) );
+    glGenBuffers( 1, &s_frameDataBuffer );
+    glBindBuffer( GL_UNIFORM_BUFFER, s_frameDataBuffer );
+    glBufferData( GL_UNIFORM_BUFFER, sizeof(FrameDataBlock), 0, GL_DYNAMIC_DRAW );
+    glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+    // nothing else uses this binding point, it stays bound
+    glBindBufferBase( GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, s_frameDataBuffer );
+    s_needsUpload = true;
+    CHECKERROR
+}
+
+void SetFrameTime( float t )
+{
+    s_current.frameTime = t;
+}
+
+float GetFrameTime()
+{
+    return s_current.frameTime;
+}
+
+void UpdateFrameData()
+{
+    s_current.windowSize[0] = GetRenderWidth();
+    s_current.windowSize[1] = GetRenderHeight();
+    // the render targets are allocated in size classes, the passes sample
+    // them with texel coordinates relative to the allocated size
+    s_current.texelSize[0] = GetTargetWidth() > 0 ? 1.0f / GetTargetWidth() : 0.0f;
+    s_current.texelSize[1] = GetTargetHeight() > 0 ? 1.0f / GetTargetHeight() : 0.0f;
+
+    if( !s_needsUpload && memcmp( &s_current, &s_uploaded, sizeof(FrameDataBlock) ) == 0 )
+        return;
+
+    glBindBuffer( GL_UNIFORM_BUFFER, s_frameDataBuffer );
+    glBufferSubData( GL_UNIFORM_BUFFER, 0, sizeof(FrameDataBlock), &s_current );
+    glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+    s_uploaded = s_current;
+    s_needsUpload = false;
+    CHECKERROR
+}
+
+NodeParamsBuffer::NodeParamsBuffer()
+: _id(0)
+{
+}
+
+NodeParamsBuffer::~NodeParamsBuffer()
+{
+    if( _id )
+        glDeleteBuffers( 1, &_id );
+}
+
+void NodeParamsBuffer::update( const void * data, unsigned int size, unsigned int binding )
+{
+    if( _id == 0 )
+        glGenBuffers( 1, &_id );
+    // nothing was uploaded before the first update
+    if( _uploaded.size() != size || memcmp( data, _uploaded.data(), size ) != 0 )
+    {
+        glBindBuffer( GL_UNIFORM_BUFFER, _id );
+        if( _uploaded.size() != size )
+            glBufferData( GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW );
+        else
+            glBufferSubData( GL_UNIFORM_BUFFER, 0, size, data );
+        glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+        _uploaded.assign( (const char*)data, (const char*)data + size );
+    }
+    glBindBufferBase( GL_UNIFORM_BUFFER, binding, _id );
+    CHECKERROR
+}
+
+}//namespace
@@ -0,0 +1,61 @@
+
+#pragma once
+#ifndef RENDERER_FRAMEDATA_HPP
+#define RENDERER_FRAMEDATA_HPP
+
+#include <vector>
+
+namespace renderer{
+
+// Binding points of the uniform blocks. Shaders declare the blocks with
+// Shader::BLOCK locations whose location is the binding point.
+enum
+{
+    FRAME_DATA_BINDING = 0,  // FrameData, shared by every pass
+    NODE_PARAMS_BINDING = 1  // parameters of the node being updated
+};
+
+// The FrameData uniform block: values that are the same for every pass of
+// a frame, uploaded once per frame instead of once per pass. The shaders
+// that read it declare it as:
+//
+//     layout(std140) uniform FrameData
+//     {
+//         vec2 windowSize;  // size of the rendered region, in pixels
+//         vec2 texelSize;   // 1 / size of the render targets
+//         float frameTime;
+//     };
+void InitFrameData();
+
+// Uploads the block if one of its values changed; called by ProcessNodes
+// once the value nodes (the timer) of the frame are updated, before the
+// other nodes.
+void UpdateFrameData();
+
+// frameTime in the block. Set by the timer node when it ticks; all the
+// passes of a frame see the time of that frame.
+void SetFrameTime( float t );
+float GetFrameTime();
+
+// The buffer of a node's parameter block (std140): re-uploaded only when
+// the packed values differ from the last upload, then bound to
+// NODE_PARAMS_BINDING (or the given binding point) for the node's passes.
+class NodeParamsBuffer
+{
+public:
+    NodeParamsBuffer();
+    ~NodeParamsBuffer();
+
+    void update( const void * data, unsigned int size, unsigned int binding = NODE_PARAMS_BINDING );
+
+private:
+    NodeParamsBuffer( const NodeParamsBuffer& );
+    NodeParamsBuffer& operator=( const NodeParamsBuffer& );
+
+    unsigned int _id;
+    std::vector<char> _uploaded;
+};
+
+}//namespace
+
+#endif
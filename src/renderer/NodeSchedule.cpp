@@ -0,0 +1,449 @@
+#include "renderer/NodeSchedule.hpp"
+#include "renderer/Profiler.hpp"
+#include "renderer/FrameData.hpp"
+#include "renderer/RenderTargetPool.hpp"
+
+#include "kiwi/core/Node.hpp"
+#include "kiwi/core/DataTypeManager.hpp"
+
+#include "glm/glm.hpp"
+
+#include <vector>
+#include <set>
+#include <map>
+#include <algorithm>
+
+using namespace kiwi::core;
+
+namespace renderer{
+
+struct ScheduledNode
+{
+    Node * node;
+    // indices in the schedule of the nodes this one reads from
+    std::vector<unsigned int> previous;
+    // index of its pooled render target, -1 if it has none
+    int target;
+    // position of the update that does the work of this node: the last
+    // node of its fused chain, or itself
+    unsigned int updatedAt;
+    // it only computes values (floats, vectors) from other values, see
+    // ProcessFrames
+    bool isValue;
+};
+
+typedef std::vector<ScheduledNode> Schedule;
+
+static Schedule s_schedule;
+static Node * s_scheduleRoot = 0;
+static bool s_scheduleValid = false;
+
+static std::set<Node*> s_dirtyNodes;
+static std::set<Node*> s_volatileNodes;
+static bool s_allDirty = true;
+static std::vector<char> s_updated;
+// for each pooled target, the position of the node whose output it holds
+static std::vector<int> s_targetOwners;
+
+static NodeChainFuser * s_fuser = 0;
+// fused chains, by position of their last node
+static std::map<unsigned int, NodeChainFuser::Chain> s_chains;
+
+// depth first, post order: a node is appended once all of its inputs are.
+static void ScheduleNode( Node * n, std::map<Node*,unsigned int>& indices )
+{
+    if( indices.find(n) != indices.end() )
+        return;
+    // placeholder so that a cycle can't recurse forever
+    indices[n] = (unsigned int)-1;
+
+    ScheduledNode entry;
+    entry.node = n;
+    entry.target = -1;
+    entry.updatedAt = 0;
+    entry.isValue = false;
+    for( auto it = n->previousNodes().begin(); it != n->previousNodes().end(); ++it )
+    {
+        ScheduleNode( *it, indices );
+        if( indices[*it] != (unsigned int)-1 )
+            entry.previous.push_back( indices[*it] );
+    }
+
+    indices[n] = s_schedule.size();
+    entry.updatedAt = s_schedule.size();
+    s_schedule.push_back( entry );
+}
+
+// Finds the chains of fusable nodes and hands them to the fuser.
+static void FuseChains()
+{
+    s_chains.clear();
+    if( !s_fuser )
+        return;
+    s_fuser->clear();
+
+    unsigned int size = s_schedule.size();
+    std::vector<unsigned int> nbReaders( size, 0 );
+    std::vector<int> reader( size, -1 );
+    for( unsigned int i = 0; i < size; ++i )
+    {
+        const std::vector<unsigned int>& previous = s_schedule[i].previous;
+        for( unsigned int p = 0; p < previous.size(); ++p )
+        {
+            ++nbReaders[ previous[p] ];
+            reader[ previous[p] ] = i;
+        }
+    }
+
+    // next[i]: the node node i can be fused into
+    std::vector<int> next( size, -1 );
+    std::vector<char> hasPrevious( size, 0 );
+    std::vector<char> fusable( size );
+    for( unsigned int i = 0; i < size; ++i )
+        fusable[i] = s_fuser->canFuse( s_schedule[i].node );
+    for( unsigned int i = 0; i < size; ++i )
+    {
+        if( fusable[i] && nbReaders[i] == 1 && fusable[ reader[i] ] )
+        {
+            next[i] = reader[i];
+            hasPrevious[ reader[i] ] = 1;
+        }
+    }
+
+    for( unsigned int i = 0; i < size; ++i )
+    {
+        if( next[i] < 0 || hasPrevious[i] )
+            continue;
+        std::vector<unsigned int> positions;
+        for( int j = i; j >= 0; j = next[j] )
+            positions.push_back( j );
+
+        // too long chains are fused in consecutive runs, each run writing
+        // the target the next one reads
+        unsigned int maxSize = std::max( s_fuser->maxChainSize(), 2u );
+        for( unsigned int first = 0; first + 1 < positions.size(); first += maxSize )
+        {
+            unsigned int end = std::min( first + maxSize, (unsigned int)positions.size() );
+            if( end - first < 2 )
+                break;
+            NodeChainFuser::Chain chain;
+            for( unsigned int j = first; j < end; ++j )
+                chain.push_back( s_schedule[ positions[j] ].node );
+            if( !s_fuser->fuse( chain ) )
+                continue;
+            unsigned int last = positions[end - 1];
+            for( unsigned int j = first; j < end; ++j )
+                s_schedule[ positions[j] ].updatedAt = last;
+            s_chains[last] = chain;
+        }
+    }
+}
+
+// a pooled target lives from the node writing it to the last node reading
+// it. The nodes downstream of a volatile node are updated every frame and
+// share targets; the others keep their output across frames in a target of
+// their own, since a node updated in between would overwrite it.
+static void AssignScheduleRenderTargets()
+{
+    std::vector<char> everyFrame( s_schedule.size(), 0 );
+    for( unsigned int i = 0; i < s_schedule.size(); ++i )
+    {
+        const ScheduledNode& entry = s_schedule[i];
+        everyFrame[i] = s_volatileNodes.find( entry.node ) != s_volatileNodes.end();
+        for( unsigned int p = 0; !everyFrame[i] && p < entry.previous.size(); ++p )
+            everyFrame[i] = everyFrame[ entry.previous[p] ];
+    }
+
+    std::vector<RenderTargetUse> uses;
+    std::vector<int> useIndex( s_schedule.size(), -1 );
+    for( unsigned int i = 0; i < s_schedule.size(); ++i )
+    {
+        // the inner nodes of a fused chain don't write anything
+        if( !HasPooledRenderTarget( s_schedule[i].node ) || s_schedule[i].updatedAt != i )
+            continue;
+        RenderTargetUse use = { s_schedule[i].node, i, i, false, !everyFrame[i], 0 };
+        useIndex[i] = uses.size();
+        uses.push_back( use );
+    }
+
+    for( unsigned int i = 0; i < s_schedule.size(); ++i )
+    {
+        const ScheduledNode& entry = s_schedule[i];
+        for( unsigned int p = 0; p < entry.previous.size(); ++p )
+        {
+            int u = useIndex[ entry.previous[p] ];
+            if( u < 0 )
+                continue;
+            bool display = IsDisplayNode( entry.node );
+            // first reader or all the readers so far are display nodes
+            uses[u].displayOnly = ( uses[u].last == uses[u].first || uses[u].displayOnly ) && display;
+            // the first node of a fused chain reads when the chain is updated
+            if( uses[u].last < entry.updatedAt )
+                uses[u].last = entry.updatedAt;
+        }
+    }
+    // the output of the last node is read after the frame (batch renderer)
+    if( !useIndex.empty() && useIndex.back() >= 0 )
+        uses[ useIndex.back() ].last = (unsigned int)-1;
+
+    // also clears the targets of the pooled nodes left out of the schedule
+    unsigned int nbTargets = AssignRenderTargets( uses );
+
+    for( unsigned int i = 0; i < uses.size(); ++i )
+        s_schedule[ uses[i].first ].target = uses[i].target;
+    s_targetOwners.assign( nbTargets, -1 );
+}
+
+// number of floats of the values the value nodes can output, 0 for the
+// other types
+static unsigned int ValueSize( const DataTypeInfo * type )
+{
+    static const DataTypeInfo * floatType = DataTypeManager::TypeOf("Float");
+    static const DataTypeInfo * vec2Type = DataTypeManager::TypeOf("Vec2");
+    static const DataTypeInfo * vec3Type = DataTypeManager::TypeOf("Vec3");
+    static const DataTypeInfo * vec4Type = DataTypeManager::TypeOf("Vec4");
+    if( type == floatType ) return 1;
+    if( type == vec2Type ) return 2;
+    if( type == vec3Type ) return 3;
+    if( type == vec4Type ) return 4;
+    return 0;
+}
+
+static float * ValueData( OutputPort& port, unsigned int size )
+{
+    switch( size )
+    {
+        case 1: return port.dataAs<float>();
+        case 2: return &port.dataAs<glm::vec2>()->x;
+        case 3: return &port.dataAs<glm::vec3>()->x;
+        default: return &port.dataAs<glm::vec4>()->x;
+    }
+}
+
+// value nodes: all of their outputs are values and they only read other
+// value nodes
+static void FindValueNodes()
+{
+    for( unsigned int i = 0; i < s_schedule.size(); ++i )
+    {
+        ScheduledNode& entry = s_schedule[i];
+        entry.isValue = entry.node->outputs().size() > 0;
+        for( unsigned int o = 0; entry.isValue && o < entry.node->outputs().size(); ++o )
+            entry.isValue = ValueSize( entry.node->output(o).dataType() ) > 0;
+        for( unsigned int p = 0; entry.isValue && p < entry.previous.size(); ++p )
+            entry.isValue = s_schedule[ entry.previous[p] ].isValue;
+    }
+}
+
+static void CompileSchedule( Node * last )
+{
+    std::map<Node*,unsigned int> indices;
+    s_schedule.clear();
+    ScheduleNode( last, indices );
+    FuseChains();
+    AssignScheduleRenderTargets();
+    FindValueNodes();
+    ResetNodeProfiles();
+    s_scheduleRoot = last;
+    s_scheduleValid = true;
+    s_updated.resize( s_schedule.size() );
+    // new connections make cached outputs stale
+    s_allDirty = true;
+}
+
+void InvalidateNodeSchedule()
+{
+    s_scheduleValid = false;
+}
+
+void ForgetNode( Node * n )
+{
+    s_dirtyNodes.erase( n );
+    s_volatileNodes.erase( n );
+    ForgetNodeProfile( n );
+    s_scheduleValid = false;
+}
+
+void MarkNodeDirty( Node * n )
+{
+    s_dirtyNodes.insert( n );
+}
+
+void MarkAllNodesDirty()
+{
+    s_allDirty = true;
+}
+
+void SetNodeVolatile( Node * n, bool isVolatile )
+{
+    if( isVolatile )
+        s_volatileNodes.insert( n );
+    else
+        s_volatileNodes.erase( n );
+    // which nodes can share their render target depends on it
+    s_scheduleValid = false;
+}
+
+void SetNodeChainFuser( NodeChainFuser * fuser )
+{
+    if( s_fuser )
+        s_fuser->clear();
+    s_fuser = fuser;
+    s_scheduleValid = false;
+}
+
+// Updates the node at position i of the schedule if it needs it, and
+// records whether it did in s_updated.
+static void UpdateScheduledNode( unsigned int i, bool allDirty, bool profile )
+{
+    const ScheduledNode& entry = s_schedule[i];
+    // another node rendered into its target since its last update
+    bool overwritten = entry.target >= 0 && s_targetOwners[ entry.target ] != (int)i;
+    bool needsUpdate = allDirty
+        || ( i == s_schedule.size() - 1 )
+        || overwritten
+        || ( s_dirtyNodes.find(entry.node) != s_dirtyNodes.end() )
+        || ( s_volatileNodes.find(entry.node) != s_volatileNodes.end() );
+
+    for( unsigned int p = 0; !needsUpdate && p < entry.previous.size(); ++p )
+        needsUpdate = s_updated[ entry.previous[p] ];
+
+    s_updated[i] = needsUpdate;
+    // the inner nodes of a fused chain are updated with its last node
+    if( needsUpdate && entry.updatedAt == i )
+    {
+        if( profile )
+            BeginNodeProfile( entry.node );
+        auto chain = s_chains.find( i );
+        if( chain != s_chains.end() )
+            s_fuser->update( chain->second );
+        else
+            entry.node->update();
+        if( profile )
+            EndNodeProfile( entry.node );
+        if( entry.target >= 0 )
+            s_targetOwners[ entry.target ] = i;
+    }
+}
+
+void ProcessNodes( Node * last )
+{
+    if( !s_scheduleValid || s_scheduleRoot != last )
+        CompileSchedule( last );
+
+    BeginFrameProfile();
+    // the value nodes only read each other, they can go first, so that the
+    // frame data has the time the timer sets for this frame
+    for( unsigned int i = 0; i < s_schedule.size(); ++i )
+        if( s_schedule[i].isValue )
+            UpdateScheduledNode( i, s_allDirty, true );
+    UpdateFrameData();
+    for( unsigned int i = 0; i < s_schedule.size(); ++i )
+        if( !s_schedule[i].isValue )
+            UpdateScheduledNode( i, s_allDirty, true );
+    EndFrameProfile();
+
+    s_dirtyNodes.clear();
+    s_allDirty = false;
+}
+
+bool ProcessFrames( Node * last, unsigned int nbFrames, FrameSink& sink )
+{
+    if( !s_scheduleValid || s_scheduleRoot != last )
+        CompileSchedule( last );
+    if( nbFrames == 0 )
+        return true;
+
+    // the outputs of the value nodes, one after the other
+    struct ValueOutput
+    {
+        float * data;
+        unsigned int size;
+    };
+    std::vector<ValueOutput> outputs;
+    std::vector<unsigned int> valueNodes;
+    for( unsigned int i = 0; i < s_schedule.size(); ++i )
+    {
+        if( !s_schedule[i].isValue )
+            continue;
+        valueNodes.push_back( i );
+        Node * n = s_schedule[i].node;
+        for( unsigned int o = 0; o < n->outputs().size(); ++o )
+        {
+            ValueOutput output;
+            output.size = ValueSize( n->output(o).dataType() );
+            output.data = ValueData( n->output(o), output.size );
+            outputs.push_back( output );
+        }
+    }
+    unsigned int frameSize = 0;
+    for( unsigned int o = 0; o < outputs.size(); ++o )
+        frameSize += outputs[o].size;
+
+    // all the frames of the value nodes first: values[f] holds their
+    // outputs at frame f and updated[f] which of them were updated
+    std::vector<float> values( nbFrames * frameSize );
+    std::vector<char> updated( nbFrames * valueNodes.size() );
+    std::vector<float> frameTimes( nbFrames );
+    for( unsigned int f = 0; f < nbFrames; ++f )
+    {
+        for( unsigned int v = 0; v < valueNodes.size(); ++v )
+        {
+            UpdateScheduledNode( valueNodes[v], s_allDirty && f == 0, false );
+            updated[ f * valueNodes.size() + v ] = s_updated[ valueNodes[v] ];
+        }
+        // as in ProcessNodes, the passes of a frame see the time the timer
+        // set for it
+        frameTimes[f] = GetFrameTime();
+        float * frame = values.data() + f * frameSize;
+        for( unsigned int o = 0; o < outputs.size(); ++o )
+        {
+            std::copy( outputs[o].data, outputs[o].data + outputs[o].size, frame );
+            frame += outputs[o].size;
+        }
+        // the dirty nodes were taken into account
+        if( f == 0 )
+            for( unsigned int v = 0; v < valueNodes.size(); ++v )
+                s_dirtyNodes.erase( s_schedule[ valueNodes[v] ].node );
+    }
+
+    // then the frames of the rendering nodes, back to back, with the
+    // values put back in place
+    bool result = true;
+    for( unsigned int f = 0; f < nbFrames && result; ++f )
+    {
+        const float * frame = values.data() + f * frameSize;
+        for( unsigned int o = 0; o < outputs.size(); ++o )
+        {
+            std::copy( frame, frame + outputs[o].size, outputs[o].data );
+            frame += outputs[o].size;
+        }
+        for( unsigned int v = 0; v < valueNodes.size(); ++v )
+            s_updated[ valueNodes[v] ] = updated[ f * valueNodes.size() + v ];
+        SetFrameTime( frameTimes[f] );
+
+        BeginFrameProfile();
+        UpdateFrameData();
+        for( unsigned int i = 0; i < s_schedule.size(); ++i )
+            if( !s_schedule[i].isValue )
+                UpdateScheduledNode( i, s_allDirty, true );
+        EndFrameProfile();
+
+        s_dirtyNodes.clear();
+        s_allDirty = false;
+
+        result = sink.frameProcessed( f );
+    }
+
+    // the next frame continues from the last one evaluated
+    const float * frame = values.data() + (nbFrames - 1) * frameSize;
+    for( unsigned int o = 0; o < outputs.size(); ++o )
+    {
+        std::copy( frame, frame + outputs[o].size, outputs[o].data );
+        frame += outputs[o].size;
+    }
+    SetFrameTime( frameTimes[nbFrames - 1] );
+    return result;
+}
+
+}//namespace
@@ -0,0 +1,88 @@
+
+#pragma once
+#ifndef RENDERER_NODESCHEDULE_HPP
+#define RENDERER_NODESCHEDULE_HPP
+
+#include <vector>
+
+namespace kiwi{ namespace core{ class Node; }}
+
+namespace renderer{
+
+// Updates every node the given node depends on, in dependency order, then
+// the node itself. The order is compiled once into a flat array and reused
+// until the graph topology changes.
+// Only nodes that are dirty, volatile or downstream of an updated node are
+// updated; the others keep the outputs of their last update. The last node
+// is always updated, and so is a node whose pooled render target (see
+// RenderTargetPool.hpp) was written by another node since its last update.
+// Only the nodes downstream of a volatile node, which are updated every
+// frame anyway, share their targets.
+void ProcessNodes( kiwi::core::Node * last );
+
+// Called by ProcessFrames once the rendering nodes of each frame are
+// updated; returning false stops the batch.
+class FrameSink
+{
+public:
+    virtual ~FrameSink() {}
+    virtual bool frameProcessed( unsigned int index ) = 0;
+};
+
+// Same as nbFrames calls to ProcessNodes, for offline rendering. The value
+// nodes (the ones computing floats and vectors from other values: timer,
+// math nodes, colours...) are first evaluated for all the frames, their
+// outputs stored in arrays, then the other nodes are updated for each frame
+// in turn, without any CPU side node work between the GPU frames. The sink
+// is called after each frame, typically to start its readback. Returns
+// false if the sink stopped the batch.
+bool ProcessFrames( kiwi::core::Node * last, unsigned int nbFrames, FrameSink& sink );
+
+// Must be called whenever a connection is made or removed.
+void InvalidateNodeSchedule();
+
+// Must be called before a node is deleted: drops everything the renderer
+// keeps about it (dirty and volatile flags, timings) and invalidates the
+// schedule.
+void ForgetNode( kiwi::core::Node * n );
+
+// Must be called when the value of one of the node's outputs is modified
+// outside of its update.
+void MarkNodeDirty( kiwi::core::Node * n );
+
+// Forces a full evaluation on the next frame (the render targets were
+// reallocated for instance).
+void MarkAllNodesDirty();
+
+// Volatile nodes produce a different output at each update (timers) and are
+// updated every frame.
+void SetNodeVolatile( kiwi::core::Node * n, bool isVolatile = true );
+
+// Merges chains of nodes into a single update. When the schedule is
+// compiled, clear() is called, then every chain of two or more nodes
+// accepted by canFuse, in which each node reads the previous one and
+// nothing else reads it, is given to fuse(), split in runs of at most
+// maxChainSize() nodes. If that returns true, update() is called for the
+// whole chain in place of the update of its last node, and the other nodes
+// of the chain are skipped (they don't get a pooled render target either).
+class NodeChainFuser
+{
+public:
+    typedef std::vector<kiwi::core::Node*> Chain;
+
+    virtual ~NodeChainFuser() {}
+    virtual unsigned int maxChainSize() const = 0;
+    virtual bool canFuse( const kiwi::core::Node * n ) = 0;
+    virtual bool fuse( const Chain& chain ) = 0;
+    virtual bool update( const Chain& chain ) = 0;
+    // forgets the chains fused so far
+    virtual void clear() = 0;
+};
+
+// The fuser is not owned by the schedule; 0 (the default) disables the
+// fusion.
+void SetNodeChainFuser( NodeChainFuser * fuser );
+
+}//namespace
+
+#endif
@@ -0,0 +1,310 @@
+#include "renderer/Pipeline.hpp"
+#include "renderer/Shader.hpp"
+#include "renderer/DrawQuad.hpp"
+#include "renderer/FrameData.hpp"
+#include "utils/LoadFile.hpp"
+#include "utils/CheckGLError.hpp"
+
+#include "nodes/TimeNode.hpp"
+#include "nodes/PostFxNode.hpp"
+#include "nodes/BloomNode.hpp"
+#include "nodes/DofNode.hpp"
+#include "nodes/RayMarchingNode.hpp"
+#include "nodes/FloatMathNodes.hpp"
+#include "nodes/ColorMix.hpp"
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <initializer_list>
+
+using namespace std;
+
+namespace renderer{
+
+static NormalEstimation s_normalEstimation = TETRAHEDRON_NORMALS;
+
+void SetNormalEstimation( NormalEstimation mode )
+{
+    s_normalEstimation = mode;
+}
+
+static bool s_postFxFusion = true;
+
+void SetPostFxFusion( bool enabled )
+{
+    s_postFxFusion = enabled;
+}
+
+static bool s_computePostFx = true;
+
+void SetComputePostFx( bool enabled )
+{
+    s_computePostFx = enabled;
+}
+
+void InitPipeline()
+{
+    CHECKERROR
+
+    InitQuad();
+    InitFrameData();
+
+    nodes::RegisterTimeNode();
+
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+
+    // shaders: the sources are read on several threads, then everything is
+    // compiled without waiting for the results. The programs are finished
+    // when first bound, see Shader::compile.
+
+    enum { MARCHER_VS, MARCHER_FS, UPSCALE_FS, RESOLVE_FS, POSTFX_VS
+         , DOF_FS, DOF_PREPARE_FS, DOF_DILATE_FS, DOF_GATHER_FS, EDGE_FS, EDGE_CS
+         , BLOOM_FS, BLOOM_DOWNSAMPLE_FS, BLOOM_BLUR_FS, RADIAL_FS, SEPIA_FS, BNW_FS, CORNERS_FS, ALPHA_FS };
+    vector<string> paths = {
+        "shaders/Raymarching.vert",
+        "shaders/Raymarching.frag",
+        "shaders/Upscale.frag",
+        "shaders/TemporalResolve.frag",
+        "shaders/SecondPass.vert",
+        "shaders/DOF.frag",
+        "shaders/DofPrepare.frag",
+        "shaders/DofDilate.frag",
+        "shaders/DofGather.frag",
+        "shaders/EdgeDetection.frag",
+        "shaders/EdgeDetection.comp",
+        "shaders/Bloom.frag",
+        "shaders/BloomDownsample.frag",
+        "shaders/BloomBlur.frag",
+        "shaders/RadialBlur.frag",
+        "shaders/Sepia.frag",
+        "shaders/BlackAndWhite.frag",
+        "shaders/Corners.frag",
+        "shaders/SetAlpha.frag"
+    };
+    vector<string> sources;
+    utils::LoadTextFiles( paths, sources );
+
+    InitShaderCompiler();
+
+    CHECKERROR
+    Shader::LocationMap marcherLoc = {
+        {"MarcherParams",   { Shader::BLOCK, NODE_PARAMS_BINDING } },
+        {"FrameData",      { Shader::BLOCK, FRAME_DATA_BINDING } },
+        {"heatmap",         { Shader::UNIFORM | Shader::INT} },
+        {"outputImage",     { Shader::OUTPUT  | Shader::TEXTURE2D} },
+        {"fragmentInfo",    { Shader::OUTPUT  | Shader::TEXTURE2D} }
+    };
+    auto raymarchingShader = new Shader;
+    CHECKERROR
+    string marcherDefines = s_normalEstimation == TETRAHEDRON_NORMALS
+                          ? "#define NORMALS TETRAHEDRON_NORMALS"
+                          : "#define NORMALS CENTRAL_DIFFERENCE_NORMALS";
+    raymarchingShader->compile( sources[MARCHER_VS], InsertDefines( sources[MARCHER_FS], marcherDefines ), marcherLoc );
+
+    Shader::LocationMap upscaleLoc = {
+        {"FrameData",       { Shader::BLOCK, FRAME_DATA_BINDING } },
+        {"inputImage",      { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"fragmentInfo",    { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"renderScale",     { Shader::UNIFORM | Shader::FLOAT} }
+    };
+    auto upscaleShader = new Shader;
+    upscaleShader->compile( sources[POSTFX_VS], sources[UPSCALE_FS], upscaleLoc );
+
+    Shader::LocationMap resolveLoc = {
+        {"FrameData",             { Shader::BLOCK, FRAME_DATA_BINDING } },
+        {"marchedImage",          { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"marchedInfo",           { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"historyImage",          { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"historyInfo",           { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"historyValid",          { Shader::UNIFORM | Shader::INT} },
+        {"parity",                { Shader::UNIFORM | Shader::FLOAT} },
+        {"regionSize",            { Shader::UNIFORM | Shader::FLOAT2} },
+        {"historyRegionSize",     { Shader::UNIFORM | Shader::FLOAT2} },
+        {"cameraPosition",        { Shader::UNIFORM | Shader::FLOAT3} },
+        {"historyCameraPosition", { Shader::UNIFORM | Shader::FLOAT3} },
+        {"fovyCoefficient",       { Shader::UNIFORM | Shader::FLOAT} }
+    };
+    auto resolveShader = new Shader;
+    resolveShader->compile( sources[POSTFX_VS], sources[RESOLVE_FS], resolveLoc );
+
+    nodes::RegisterRayMarchingNode(raymarchingShader, upscaleShader, resolveShader);
+
+
+    CHECKERROR
+
+    //  Depth Of Field: circle of confusion, near field dilation and gather
+    //  at half resolution, composite
+
+    Shader::LocationMap dofPrepareLoc = {
+        {"FrameData",       { Shader::BLOCK, FRAME_DATA_BINDING } },
+        {"DofParams",       { Shader::BLOCK, NODE_PARAMS_BINDING } },
+        {"inputImage",      { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"fragmentInfo",    { Shader::UNIFORM | Shader::TEXTURE2D} }
+    };
+    auto dofPrepareShader = new Shader;
+    dofPrepareShader->compile( sources[POSTFX_VS], sources[DOF_PREPARE_FS], dofPrepareLoc );
+
+    Shader::LocationMap dofDilateLoc = {
+        {"sourceImage",     { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"sourceRegion",    { Shader::UNIFORM | Shader::FLOAT2} }
+    };
+    auto dofDilateShader = new Shader;
+    dofDilateShader->compile( sources[POSTFX_VS], sources[DOF_DILATE_FS], dofDilateLoc );
+
+    Shader::LocationMap dofGatherLoc = {
+        {"sourceImage",     { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"sourceTexelSize", { Shader::UNIFORM | Shader::FLOAT2} },
+        {"sourceRegion",    { Shader::UNIFORM | Shader::FLOAT2} }
+    };
+    auto dofGatherShader = new Shader;
+    dofGatherShader->compile( sources[POSTFX_VS], sources[DOF_GATHER_FS], dofGatherLoc );
+
+    Shader::LocationMap dofLoc = {
+        {"FrameData",        { Shader::BLOCK, FRAME_DATA_BINDING } },
+        {"DofParams",        { Shader::BLOCK, NODE_PARAMS_BINDING } },
+        {"inputImage",       { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"fragmentInfo",     { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"blurredImage",     { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"blurredTexelSize", { Shader::UNIFORM | Shader::FLOAT2} },
+        {"blurredRegion",    { Shader::UNIFORM | Shader::FLOAT2} }
+    };
+    auto dofShader = new Shader;
+    CHECKERROR
+    dofShader->compile( sources[POSTFX_VS], sources[DOF_FS], dofLoc );
+
+    CHECKERROR
+
+    nodes::RegisterDofNode( dofPrepareShader, dofDilateShader, dofGatherShader, dofShader );
+    nodes::RegisterScreenNode();
+
+    //  Edge Detection Shader
+
+    Shader::LocationMap edgeLoc = {
+        {"inputImage",   { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"fragmentInfo",  { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"edgeColor",      { Shader::UNIFORM | Shader::PARAM | Shader::FLOAT3} },
+        {"NodeParams",    { Shader::BLOCK, NODE_PARAMS_BINDING } },
+        {"FrameData",     { Shader::BLOCK, FRAME_DATA_BINDING } }
+
+    };
+    auto edgeShader = new Shader;
+    CHECKERROR
+    edgeShader->compile( sources[POSTFX_VS], sources[EDGE_FS], edgeLoc );
+    // tiled compute version when the context has it, see RegisterPostFxNode
+    nodes::RegisterPostFxNode( edgeShader  ,"Edge detection", RGBA16F,
+                               s_computePostFx ? sources[EDGE_CS] : "" );
+
+    //  Bloom: downsampling, blur of each level, composite
+
+    Shader::LocationMap bloomDownsampleLoc = {
+        {"sourceImage",      { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"sourceTexelSize",  { Shader::UNIFORM | Shader::FLOAT2} },
+        {"sourceRegion",     { Shader::UNIFORM | Shader::FLOAT2} }
+    };
+    auto bloomDownsampleShader = new Shader;
+    bloomDownsampleShader->compile( sources[POSTFX_VS], sources[BLOOM_DOWNSAMPLE_FS], bloomDownsampleLoc );
+
+    Shader::LocationMap bloomBlurLoc = {
+        {"sourceImage",      { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"sourceTexelSize",  { Shader::UNIFORM | Shader::FLOAT2} },
+        {"sourceRegion",     { Shader::UNIFORM | Shader::FLOAT2} },
+        {"direction",        { Shader::UNIFORM | Shader::FLOAT2} },
+        {"coarserImage",     { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"coarserTexelSize", { Shader::UNIFORM | Shader::FLOAT2} },
+        {"coarserRegion",    { Shader::UNIFORM | Shader::FLOAT2} },
+        {"addCoarser",       { Shader::UNIFORM | Shader::INT} }
+    };
+    auto bloomBlurShader = new Shader;
+    bloomBlurShader->compile( sources[POSTFX_VS], sources[BLOOM_BLUR_FS], bloomBlurLoc );
+
+    Shader::LocationMap bloomLoc = {
+        {"inputImage",      { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"bloomImage",      { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"bloomTexelSize",  { Shader::UNIFORM | Shader::FLOAT2} },
+        {"bloomRegion",     { Shader::UNIFORM | Shader::FLOAT2} },
+        {"BloomParams",     { Shader::BLOCK, NODE_PARAMS_BINDING } },
+        {"FrameData",      { Shader::BLOCK, FRAME_DATA_BINDING } }
+    };
+    auto bloomShader = new Shader;
+    CHECKERROR
+    bloomShader->compile( sources[POSTFX_VS], sources[BLOOM_FS], bloomLoc );
+    nodes::RegisterBloomNode( bloomDownsampleShader, bloomBlurShader, bloomShader );
+
+    //  Radial Blur Shader
+
+    Shader::LocationMap radialLoc = {
+        {"inputImage",   { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"FrameData",     { Shader::BLOCK, FRAME_DATA_BINDING } }
+    };
+    auto radialShader = new Shader;
+    CHECKERROR
+    radialShader->compile( sources[POSTFX_VS], sources[RADIAL_FS], radialLoc );
+    nodes::RegisterPostFxNode( radialShader  ,"Radial blur");
+  
+
+    //-----------------------------------------------------
+    Shader::LocationMap sepiaMap = {
+        {"inputImage",   { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"factor",         { Shader::UNIFORM | Shader::PARAM | Shader::FLOAT} },
+        {"NodeParams",    { Shader::BLOCK, NODE_PARAMS_BINDING } },
+        {"FrameData",     { Shader::BLOCK, FRAME_DATA_BINDING } }
+
+    };
+    auto sepiaShader = new Shader;
+    sepiaShader->compile( sources[POSTFX_VS], sources[SEPIA_FS], sepiaMap );
+    nodes::RegisterPostFxNode( sepiaShader  ,"Sepia");
+  
+
+    //-----------------------------------------------------
+    Shader::LocationMap bnwMap = {
+        {"inputImage",   { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"factor",         { Shader::UNIFORM | Shader::PARAM | Shader::FLOAT} },
+        {"NodeParams",    { Shader::BLOCK, NODE_PARAMS_BINDING } },
+        {"FrameData",     { Shader::BLOCK, FRAME_DATA_BINDING } }
+
+    };
+    auto bnwShader = new Shader;
+    bnwShader->compile( sources[POSTFX_VS], sources[BNW_FS], bnwMap );
+    nodes::RegisterPostFxNode( bnwShader  ,"Black and white");
+  
+    //-----------------------------------------------------
+    Shader::LocationMap cornerMap = {
+        {"inputImage",     { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"cornerColor",          { Shader::UNIFORM | Shader::PARAM | Shader::FLOAT3} },
+        {"offset",         { Shader::UNIFORM | Shader::PARAM | Shader::FLOAT} },
+        {"factor",         { Shader::UNIFORM | Shader::PARAM | Shader::FLOAT} },
+        {"NodeParams",    { Shader::BLOCK, NODE_PARAMS_BINDING } },
+        {"FrameData",     { Shader::BLOCK, FRAME_DATA_BINDING } }
+    };
+    auto cornerShader = new Shader;
+    cornerShader->compile( sources[POSTFX_VS], sources[CORNERS_FS], cornerMap );
+    nodes::RegisterPostFxNode( cornerShader  ,"Corners");
+  
+    //-----------------------------------------------------
+    Shader::LocationMap alphaMap = {
+        {"inputImage",   { Shader::UNIFORM | Shader::TEXTURE2D} },
+        {"alpha",         { Shader::UNIFORM | Shader::PARAM | Shader::FLOAT} },
+        {"NodeParams",    { Shader::BLOCK, NODE_PARAMS_BINDING } },
+        {"FrameData",     { Shader::BLOCK, FRAME_DATA_BINDING } }
+
+    };
+    auto alphaShader = new Shader;
+    alphaShader->compile( sources[POSTFX_VS], sources[ALPHA_FS], alphaMap );
+    nodes::RegisterPostFxNode( alphaShader  ,"Force alpha");
+
+    //-----------------------------------------------------
+    // chains of these are drawn in a single pass
+    nodes::RegisterPointwiseEffect( "Sepia", sources[SEPIA_FS] );
+    nodes::RegisterPointwiseEffect( "Black and white", sources[BNW_FS] );
+    nodes::RegisterPointwiseEffect( "Corners", sources[CORNERS_FS] );
+    nodes::RegisterPointwiseEffect( "Force alpha", sources[ALPHA_FS] );
+    nodes::EnablePostFxFusion( sources[POSTFX_VS], s_postFxFusion );
+
+    CHECKERROR
+
+    nodes::RegisterFloatMathNodes();
+    nodes::RegisterColorMixNode();
+}
+
+}//namespace
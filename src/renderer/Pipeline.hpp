@@ -0,0 +1,33 @@
+
+#pragma once
+#ifndef RENDERER_PIPELINE_HPP
+#define RENDERER_PIPELINE_HPP
+
+namespace renderer{
+
+// Builds the shaders and registers the render node types. Needs a current
+// GL context but no window system, so that the interactive application and
+// the batch renderer share it.
+void InitPipeline();
+
+// How the ray marcher estimates the normals at the hit points; chosen when
+// its shader is built, so it must be set before InitPipeline.
+enum NormalEstimation
+{
+    CENTRAL_DIFFERENCE_NORMALS, // 6 distance evaluations
+    TETRAHEDRON_NORMALS         // 4 distance evaluations (the default)
+};
+void SetNormalEstimation( NormalEstimation mode );
+
+// Whether chains of point-wise post effects are drawn in a single pass
+// (the default), see nodes/PostFxNode.hpp. Must be set before InitPipeline.
+void SetPostFxFusion( bool enabled );
+
+// Whether the post effects that have a compute shader version use it when
+// the context supports compute shaders (the default). Must be set before
+// InitPipeline.
+void SetComputePostFx( bool enabled );
+
+}//namespace
+
+#endif
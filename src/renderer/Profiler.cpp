@@ -0,0 +1,289 @@
+#include <GL/glew.h>
+
+#include "renderer/Profiler.hpp"
+
+#include "kiwi/core/Node.hpp"
+#include "kiwi/core/NodeTypeManager.hpp"
+
+#include <vector>
+#include <map>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <assert.h>
+
+using namespace kiwi::core;
+
+namespace renderer{
+
+typedef std::chrono::steady_clock Clock;
+
+static double MillisecondsBetween( Clock::time_point start, Clock::time_point end )
+{
+    return std::chrono::duration<double, std::milli>( end - start ).count();
+}
+
+// frames in flight before the queries of a frame are read back
+enum{ PROFILE_LATENCY = 2 };
+
+struct Sample
+{
+    double cpu;
+    double gpu;
+    double count;
+};
+
+// ring buffer of the last samples
+struct History
+{
+    History() : next(0), size(0) {}
+
+    void push( const Sample& s )
+    {
+        samples[next] = s;
+        next = (next + 1) % PROFILE_HISTORY;
+        if( size < PROFILE_HISTORY )
+            ++size;
+    }
+
+    Sample average() const
+    {
+        Sample result = { 0.0, 0.0, 0.0 };
+        unsigned int nbGpu = 0;
+        for( unsigned int i = 0; i < size; ++i )
+        {
+            result.cpu += samples[i].cpu;
+            result.count += samples[i].count;
+            if( samples[i].gpu >= 0.0 )
+            {
+                result.gpu += samples[i].gpu;
+                ++nbGpu;
+            }
+        }
+        if( size != 0 )
+        {
+            result.cpu /= size;
+            result.count /= size;
+        }
+        result.gpu = nbGpu != 0 ? result.gpu / nbGpu : -1.0;
+        return result;
+    }
+
+    Sample samples[PROFILE_HISTORY];
+    unsigned int next;
+    unsigned int size;
+};
+
+struct PendingNode
+{
+    const Node * node;
+    GLuint query;
+    double cpu;
+};
+
+// what a frame left to read back
+struct FrameSlot
+{
+    FrameSlot() : cpu(0.0), used(false) {}
+
+    std::vector<GLuint> queries;
+    std::vector<PendingNode> nodes;
+    double cpu;
+    bool used;
+};
+
+static FrameSlot s_slots[PROFILE_LATENCY + 1];
+static unsigned int s_frame = 0;
+static int s_hasTimers = -1;
+static std::map<const Node*, History> s_nodeHistory;
+static History s_frameHistory;
+static Clock::time_point s_frameStart;
+static Clock::time_point s_nodeStart;
+static Clock::time_point s_lastDump = Clock::now();
+static double s_dumpInterval = 0.0;
+
+static bool HasTimers()
+{
+    if( s_hasTimers < 0 )
+        s_hasTimers = ( GLEW_VERSION_3_3 || GLEW_ARB_timer_query ) ? 1 : 0;
+    return s_hasTimers == 1;
+}
+
+static void ResolveSlot( FrameSlot& slot, bool wait )
+{
+    if( !slot.used )
+        return;
+
+    double frameGpu = 0.0;
+    for( unsigned int i = 0; i < slot.nodes.size(); ++i )
+    {
+        const PendingNode& pending = slot.nodes[i];
+        double gpu = -1.0;
+        if( pending.query != 0 )
+        {
+            GLint available = GL_TRUE;
+            if( !wait )
+                glGetQueryObjectiv( pending.query, GL_QUERY_RESULT_AVAILABLE, &available );
+            if( available )
+            {
+                GLuint64 nanoseconds = 0;
+                glGetQueryObjectui64v( pending.query, GL_QUERY_RESULT, &nanoseconds );
+                gpu = nanoseconds * 1e-6;
+            }
+        }
+        // a missing result poisons the frame total but not the other nodes
+        if( gpu < 0.0 || frameGpu < 0.0 )
+            frameGpu = -1.0;
+        else
+            frameGpu += gpu;
+
+        // 0 once the node was forgotten
+        if( pending.node != 0 )
+        {
+            Sample s = { pending.cpu, gpu, 1.0 };
+            s_nodeHistory[pending.node].push( s );
+        }
+    }
+
+    Sample s = { slot.cpu, slot.nodes.empty() ? 0.0 : frameGpu, (double)slot.nodes.size() };
+    s_frameHistory.push( s );
+
+    slot.nodes.clear();
+    slot.used = false;
+}
+
+void BeginFrameProfile()
+{
+    FrameSlot& slot = s_slots[ s_frame % (PROFILE_LATENCY + 1) ];
+    ResolveSlot( slot, false );
+    slot.used = true;
+    s_frameStart = Clock::now();
+}
+
+void EndFrameProfile()
+{
+    Clock::time_point now = Clock::now();
+    s_slots[ s_frame % (PROFILE_LATENCY + 1) ].cpu = MillisecondsBetween( s_frameStart, now );
+    ++s_frame;
+
+    if( s_dumpInterval > 0.0 && MillisecondsBetween( s_lastDump, now ) > s_dumpInterval * 1000.0 )
+    {
+        PrintProfile( std::cout );
+        s_lastDump = now;
+    }
+}
+
+void BeginNodeProfile( Node * n )
+{
+    FrameSlot& slot = s_slots[ s_frame % (PROFILE_LATENCY + 1) ];
+    PendingNode pending = { n, 0, 0.0 };
+    if( HasTimers() )
+    {
+        unsigned int index = slot.nodes.size();
+        if( index == slot.queries.size() )
+        {
+            GLuint query;
+            glGenQueries( 1, &query );
+            slot.queries.push_back( query );
+        }
+        pending.query = slot.queries[index];
+        glBeginQuery( GL_TIME_ELAPSED, pending.query );
+    }
+    slot.nodes.push_back( pending );
+    s_nodeStart = Clock::now();
+}
+
+void EndNodeProfile( Node * n )
+{
+    FrameSlot& slot = s_slots[ s_frame % (PROFILE_LATENCY + 1) ];
+    PendingNode& pending = slot.nodes.back();
+    assert( pending.node == n );
+    pending.cpu = MillisecondsBetween( s_nodeStart, Clock::now() );
+    if( pending.query != 0 )
+        glEndQuery( GL_TIME_ELAPSED );
+}
+
+unsigned int GetFrameCount()
+{
+    return s_frame;
+}
+
+void FlushProfile()
+{
+    // oldest frame first
+    for( unsigned int i = 0; i <= PROFILE_LATENCY; ++i )
+        ResolveSlot( s_slots[ (s_frame + i) % (PROFILE_LATENCY + 1) ], true );
+}
+
+// the queries in flight still count in the frame totals
+static void ForgetPendingNodes( const Node * n )
+{
+    for( unsigned int i = 0; i <= PROFILE_LATENCY; ++i )
+    {
+        std::vector<PendingNode>& nodes = s_slots[i].nodes;
+        for( unsigned int j = 0; j < nodes.size(); ++j )
+            if( n == 0 || nodes[j].node == n )
+                nodes[j].node = 0;
+    }
+}
+
+void ForgetNodeProfile( const Node * n )
+{
+    s_nodeHistory.erase( n );
+    ForgetPendingNodes( n );
+}
+
+void ResetNodeProfiles()
+{
+    s_nodeHistory.clear();
+    ForgetPendingNodes( 0 );
+}
+
+bool GetNodeTiming( const Node * n, NodeTiming& result )
+{
+    auto it = s_nodeHistory.find( n );
+    if( it == s_nodeHistory.end() )
+        return false;
+    Sample s = it->second.average();
+    result.cpuMilliseconds = s.cpu;
+    result.gpuMilliseconds = s.gpu;
+    return true;
+}
+
+bool GetFrameTiming( FrameTiming& result )
+{
+    if( s_frameHistory.size == 0 )
+        return false;
+    Sample s = s_frameHistory.average();
+    result.cpuMilliseconds = s.cpu;
+    result.gpuMilliseconds = s.gpu;
+    result.nbUpdatedNodes = s.count;
+    return true;
+}
+
+void PrintProfile( std::ostream& out )
+{
+    FrameTiming frame;
+    if( !GetFrameTiming( frame ) )
+        return;
+
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+    out << "frame: " << frame.cpuMilliseconds << " ms cpu, "
+        << frame.gpuMilliseconds << " ms gpu, "
+        << frame.nbUpdatedNodes << " nodes updated\n";
+    for( auto it = s_nodeHistory.begin(); it != s_nodeHistory.end(); ++it )
+    {
+        Sample s = it->second.average();
+        out << "  " << std::setw(20) << std::left << it->first->type()->name() << std::right
+            << " " << s.cpu << " ms cpu, " << s.gpu << " ms gpu\n";
+    }
+    out.flags( flags );
+}
+
+void SetProfileDumpInterval( double seconds )
+{
+    s_dumpInterval = seconds;
+}
+
+}//namespace
@@ -0,0 +1,63 @@
+
+#pragma once
+#ifndef RENDERER_PROFILER_HPP
+#define RENDERER_PROFILER_HPP
+
+#include <ostream>
+
+namespace kiwi{ namespace core{ class Node; }}
+
+namespace renderer{
+
+// Per node and per frame timings, averaged over the last PROFILE_HISTORY
+// samples. gpuMilliseconds is negative when timer queries are not
+// supported or no result came back yet.
+enum{ PROFILE_HISTORY = 32 };
+
+struct NodeTiming
+{
+    double cpuMilliseconds;
+    double gpuMilliseconds;
+};
+
+struct FrameTiming
+{
+    double cpuMilliseconds;
+    double gpuMilliseconds;
+    double nbUpdatedNodes;
+};
+
+// Called by ProcessNodes around a frame and around each node update.
+// GPU time is measured with GL_TIME_ELAPSED queries whose results are read
+// PROFILE_LATENCY frames later, so that reading them never stalls.
+void BeginFrameProfile();
+void EndFrameProfile();
+void BeginNodeProfile( kiwi::core::Node * n );
+void EndNodeProfile( kiwi::core::Node * n );
+
+// Number of frames ended so far; the same during the whole update of a
+// frame.
+unsigned int GetFrameCount();
+
+// Waits for the pending queries; only meant for the end of a batch render.
+void FlushProfile();
+
+// Drops the timings of a node, before it is deleted.
+void ForgetNodeProfile( const kiwi::core::Node * n );
+// Drops the timings of all the nodes; called when the schedule is compiled
+// again, since the nodes that are updated and their work may have changed.
+void ResetNodeProfiles();
+
+// false if the node was never updated.
+bool GetNodeTiming( const kiwi::core::Node * n, NodeTiming& result );
+bool GetFrameTiming( FrameTiming& result );
+
+void PrintProfile( std::ostream& out );
+
+// Prints the profile to the standard output every given number of seconds
+// (0, the default, disables it).
+void SetProfileDumpInterval( double seconds );
+
+}//namespace
+
+#endif
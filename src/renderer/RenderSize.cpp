@@ -0,0 +1,52 @@
+#include "renderer/RenderSize.hpp"
+
+namespace renderer{
+
+// granularity of the target size classes, in pixels
+static const int TARGET_SIZE_STEP = 128;
+
+static int s_width = 0;
+static int s_height = 0;
+static int s_targetWidth = 0;
+static int s_targetHeight = 0;
+
+// Returns the new allocated size for one dimension: unchanged while the
+// needed size is between half the allocated size and the allocated size,
+// otherwise the needed size plus 1/8 of headroom rounded up to the step.
+static int TargetSize( int needed, int allocated )
+{
+    if( needed <= allocated && needed * 2 >= allocated )
+        return allocated;
+    int size = needed + needed / 8;
+    return ( size + TARGET_SIZE_STEP - 1 ) / TARGET_SIZE_STEP * TARGET_SIZE_STEP;
+}
+
+void SetRenderSize( int w, int h )
+{
+    s_width = w;
+    s_height = h;
+    s_targetWidth = TargetSize( w, s_targetWidth );
+    s_targetHeight = TargetSize( h, s_targetHeight );
+}
+
+int GetRenderWidth()
+{
+    return s_width;
+}
+
+int GetRenderHeight()
+{
+    return s_height;
+}
+
+int GetTargetWidth()
+{
+    return s_targetWidth;
+}
+
+int GetTargetHeight()
+{
+    return s_targetHeight;
+}
+
+}//namespace
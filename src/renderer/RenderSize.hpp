@@ -0,0 +1,23 @@
+#pragma once
+#ifndef RENDERER_RENDERSIZE_HPP
+#define RENDERER_RENDERSIZE_HPP
+
+namespace renderer{
+
+// Size of the rendered image. Set by whatever owns the GL context (the
+// GLWidget or the batch renderer), read by the render nodes.
+void SetRenderSize( int w, int h );
+int GetRenderWidth();
+int GetRenderHeight();
+
+// Size the render targets are allocated at. It is the render size rounded
+// up to a size class, and only changes when the render size grows past it
+// or shrinks below half of it, so resizing the window does not reallocate
+// the targets on every step. The passes render into the lower left
+// GetRenderWidth() x GetRenderHeight() region of the targets.
+int GetTargetWidth();
+int GetTargetHeight();
+
+}//namespace
+
+#endif
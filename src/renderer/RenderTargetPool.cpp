@@ -0,0 +1,104 @@
+#include "renderer/RenderTargetPool.hpp"
+#include "renderer/FrameBuffer.hpp"
+#include "renderer/RenderSize.hpp"
+
+#include "kiwi/core/Node.hpp"
+#include "kiwi/core/OutputPort.hpp"
+
+#include <set>
+#include <map>
+#include <iostream>
+
+using namespace kiwi::core;
+
+namespace renderer{
+
+struct PooledTarget
+{
+    FrameBuffer * fbo;
+    TextureFormat format;
+    // schedule position of the last read of the current user, -1 if the
+    // target belongs to a cached node
+    unsigned int busyUntil;
+    unsigned int nbUsers;
+};
+
+static std::map<const Node*, TextureFormat> s_pooledNodes;
+static std::set<const Node*> s_displayNodes;
+static std::vector<PooledTarget> s_targets;
+
+void SetPooledRenderTarget( Node * n, TextureFormat format )
+{
+    s_pooledNodes[n] = format;
+}
+
+bool HasPooledRenderTarget( const Node * n )
+{
+    return s_pooledNodes.find( n ) != s_pooledNodes.end();
+}
+
+void SetDisplayNode( Node * n )
+{
+    s_displayNodes.insert( n );
+}
+
+bool IsDisplayNode( const Node * n )
+{
+    return s_displayNodes.find( n ) != s_displayNodes.end();
+}
+
+unsigned int AssignRenderTargets( std::vector<RenderTargetUse>& uses )
+{
+    for( unsigned int t = 0; t < s_targets.size(); ++t )
+        s_targets[t].nbUsers = 0;
+
+    // the nodes left out of the schedule must not keep a target that is now
+    // someone else's
+    for( auto it = s_pooledNodes.begin(); it != s_pooledNodes.end(); ++it )
+    {
+        Node * n = const_cast<Node*>( it->first );
+        *n->output(0).dataAs<FrameBuffer*>() = 0;
+        *n->output(1).dataAs<Texture2D*>() = 0;
+    }
+
+    for( unsigned int i = 0; i < uses.size(); ++i )
+    {
+        RenderTargetUse& use = uses[i];
+        TextureFormat format = use.displayOnly ? RGBA8 : s_pooledNodes[use.node];
+
+        // first target of the right format free before this node writes; a
+        // cached node needs one that nobody else used
+        unsigned int t = 0;
+        while( t < s_targets.size()
+            && ( s_targets[t].format != format
+              || ( s_targets[t].nbUsers != 0 && ( use.cached || s_targets[t].busyUntil >= use.first ) ) ) )
+            ++t;
+
+        if( t == s_targets.size() )
+        {
+            // post-fx passes don't need a depth attachment
+            PooledTarget target;
+            target.fbo = new FrameBuffer( FrameBuffer::FormatArray(1, format), GetTargetWidth(), GetTargetHeight(), false );
+            target.format = format;
+            target.nbUsers = 0;
+            s_targets.push_back( target );
+        }
+
+        s_targets[t].busyUntil = use.cached ? (unsigned int)-1 : use.last;
+        ++s_targets[t].nbUsers;
+        use.target = t;
+
+        FrameBuffer * fbo = s_targets[t].fbo;
+        *use.node->output(0).dataAs<FrameBuffer*>() = fbo;
+        *use.node->output(1).dataAs<Texture2D*>() = &fbo->texture(0);
+    }
+
+    int bytesPerPixel = 0;
+    for( unsigned int t = 0; t < s_targets.size(); ++t )
+        bytesPerPixel += BytesPerPixel( s_targets[t].format );
+    std::cout << "render target pool: " << uses.size() << " pooled nodes, "
+              << s_targets.size() << " targets, " << bytesPerPixel << " bytes per pixel" << std::endl;
+    return s_targets.size();
+}
+
+}//namespace
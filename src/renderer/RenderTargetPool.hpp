@@ -0,0 +1,49 @@
+
+#pragma once
+#ifndef RENDERER_RENDERTARGETPOOL_HPP
+#define RENDERER_RENDERTARGETPOOL_HPP
+
+#include <vector>
+#include "renderer/TextureFormat.hpp"
+
+namespace kiwi{ namespace core{ class Node; }}
+
+namespace renderer{
+
+// Nodes with a pooled render target don't own their frame buffer: output 0
+// (FrameBuffer*) and output 1 (its colour texture) are set when the node
+// schedule is compiled, and nodes whose outputs are never alive at the same
+// time share the same target. format is what the node needs to store.
+void SetPooledRenderTarget( kiwi::core::Node * n, TextureFormat format = RGBA16F );
+bool HasPooledRenderTarget( const kiwi::core::Node * n );
+
+// Nodes that only put their input on screen (the Screen node). A target
+// that is only read by such nodes is stored as RGBA8 whatever the format of
+// the node writing it.
+void SetDisplayNode( kiwi::core::Node * n );
+bool IsDisplayNode( const kiwi::core::Node * n );
+
+// Position in the schedule of the node writing the target and of the last
+// node reading it.
+struct RenderTargetUse
+{
+    kiwi::core::Node * node;
+    unsigned int first;
+    unsigned int last;
+    // all the nodes reading the target are display nodes
+    bool displayOnly;
+    // the node is not updated every frame and its output must survive until
+    // the next one: its target is not shared with any other node
+    bool cached;
+    // set by AssignRenderTargets, index of the target in the pool
+    unsigned int target;
+};
+
+// Called by the schedule compiler, uses must be sorted by first. The pooled
+// nodes that are not in uses get null outputs. Returns the number of
+// targets in the pool.
+unsigned int AssignRenderTargets( std::vector<RenderTargetUse>& uses );
+
+}//namespace
+
+#endif
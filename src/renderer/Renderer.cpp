@@ -3,7 +3,8 @@
 #include "renderer/Shader.hpp"
 #include "utils/CheckGLError.hpp"
 #include "renderer/FrameBuffer.hpp"
-#include "renderer/DrawQuad.hpp"
+#include "renderer/Pipeline.hpp"
+#include "renderer/NodeSchedule.hpp"
 
 #include "kiwi/core/all.hpp"
 
@@ -22,11 +23,11 @@
 #include "io/ColorNodeView.hpp"
 #include "io/PortView.hpp"
 #include "io/SliderNodeView.hpp"
+#include "io/NodeMenu.hpp"
 
 #include <GL/glew.h>
 #include <iostream>
 #include <time.h>
-#include <algorithm>
 #include <initializer_list>
 
 
@@ -47,174 +48,12 @@ namespace renderer{
 
   void Renderer::init(){
       
-    CHECKERROR
-    
-    InitQuad();
-    
-    nodes::RegisterTimeNode();
+    InitPipeline();
 
     timeNode = nodes::CreateTimeNode();
-    
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-
-    // shaders
-
-    CHECKERROR
-    string vs, fs;
-    utils::LoadTextFile("shaders/Raymarching.vert", vs);
-    utils::LoadTextFile("shaders/Raymarching.frag", fs);
-    Shader::LocationMap marcherLoc = {
-        {"viewMatrix",      { Shader::UNIFORM | Shader::MAT4F} },
-        {"shadowColor",     { Shader::UNIFORM | Shader::FLOAT3} },
-        {"skyColor",        { Shader::UNIFORM | Shader::FLOAT3} },
-        {"groundColor",     { Shader::UNIFORM | Shader::FLOAT3} },
-        {"buildingsColor",  { Shader::UNIFORM | Shader::FLOAT3} },
-        {"redColor",        { Shader::UNIFORM | Shader::FLOAT3} },
-        {"time",            { Shader::UNIFORM | Shader::FLOAT} },
-        {"shadowHardness",  { Shader::UNIFORM | Shader::FLOAT} },
-        {"fovyCoefficient", { Shader::UNIFORM | Shader::FLOAT} },
-        {"windowSize",      { Shader::UNIFORM | Shader::FLOAT2} },
-        {"outputImage",     { Shader::OUTPUT  | Shader::TEXTURE2D} },
-        {"fragmentInfo",    { Shader::OUTPUT  | Shader::TEXTURE2D} }
-    };
-    raymarchingShader = new Shader;
-    CHECKERROR
-    raymarchingShader->build( vs, fs, marcherLoc );
-
-    nodes::RegisterRayMarchingNode(raymarchingShader);
-
-
-    CHECKERROR
-    vs.clear();
-    fs.clear();
-
-    utils::LoadTextFile("shaders/SecondPass.vert", vs);
-
-    //  Depth Of Field Shader
-    utils::LoadTextFile("shaders/DOF.frag", fs);
-    Shader::LocationMap postFxLoc = {
-        {"windowSize",      { Shader::UNIFORM | Shader::FLOAT2} },        
-        {"highlightGain",   { Shader::UNIFORM | Shader::FLOAT} },
-        {"focalDepth",      { Shader::UNIFORM | Shader::FLOAT} },
-        {"focalRange",      { Shader::UNIFORM | Shader::FLOAT} },
-        {"inputImage",   { Shader::UNIFORM | Shader::TEXTURE2D} },
-        {"fragmentInfo",  { Shader::UNIFORM | Shader::TEXTURE2D} }
-    };
-    postEffectShader = new Shader;
-    CHECKERROR
-    postEffectShader->build( vs, fs, postFxLoc );
-
-    CHECKERROR
-
-    nodes::RegisterPostFxNode( postEffectShader ,"Depth of field");
-    nodes::RegisterScreenNode();
-
-    //  Edge Detection Shader
-
-    fs.clear();
-    utils::LoadTextFile("shaders/EdgeDetection.frag", fs);
-    Shader::LocationMap edgeLoc = {
-        {"inputImage",   { Shader::UNIFORM | Shader::TEXTURE2D} },
-        {"fragmentInfo",  { Shader::UNIFORM | Shader::TEXTURE2D} },
-        {"edgeColor",      { Shader::UNIFORM | Shader::FLOAT3} },
-        {"windowSize",     { Shader::UNIFORM | Shader::FLOAT2} }
-
-    };
-    auto edgeShader = new Shader;
-    CHECKERROR
-    edgeShader->build( vs, fs, edgeLoc  );
-    nodes::RegisterPostFxNode( edgeShader  ,"Edge detection");
-
-    //  Bloom Shader
-
-    fs.clear();
-    utils::LoadTextFile("shaders/Bloom.frag", fs);
-    Shader::LocationMap bloomLoc = {
-        {"inputImage",      { Shader::UNIFORM | Shader::TEXTURE2D} },
-        {"bloomCoefficient",{ Shader::UNIFORM | Shader::FLOAT} },
-        {"windowSize",      { Shader::UNIFORM | Shader::FLOAT2} }
-    };
-    auto bloomShader = new Shader;
-    CHECKERROR
-    bloomShader->build( vs, fs, bloomLoc  );
-    nodes::RegisterPostFxNode( bloomShader  ,"Bloom");
-
-    //  Radial Blur Shader
-
-    fs.clear();
-    utils::LoadTextFile("shaders/RadialBlur.frag", fs);
-    Shader::LocationMap radialLoc = {
-        {"inputImage",   { Shader::UNIFORM | Shader::TEXTURE2D} },
-        {"windowSize",     { Shader::UNIFORM | Shader::FLOAT2} }
-    };
-    auto radialShader = new Shader;
-    CHECKERROR
-    radialShader->build( vs, fs, radialLoc  );
-    nodes::RegisterPostFxNode( radialShader  ,"Radial blur");
-    
-
-    //-----------------------------------------------------
-    fs.clear();
-    utils::LoadTextFile("shaders/Sepia.frag", fs );
-    Shader::LocationMap sepiaMap = {
-        {"inputImage",   { Shader::UNIFORM | Shader::TEXTURE2D} },
-        {"factor",         { Shader::UNIFORM | Shader::FLOAT} },
-        {"windowSize",     { Shader::UNIFORM | Shader::FLOAT2} }
-
-    };
-    auto sepiaShader = new Shader;
-    sepiaShader->build(vs,fs,sepiaMap);
-    nodes::RegisterPostFxNode( sepiaShader  ,"Sepia");
-    
-
-    //-----------------------------------------------------
-    fs.clear();
-    utils::LoadTextFile("shaders/BlackAndWhite.frag", fs );
-    Shader::LocationMap bnwMap = {
-        {"inputImage",   { Shader::UNIFORM | Shader::TEXTURE2D} },
-        {"factor",         { Shader::UNIFORM | Shader::FLOAT} },
-        {"windowSize",     { Shader::UNIFORM | Shader::FLOAT2} }
-
-    };
-    auto bnwShader = new Shader;
-    bnwShader->build(vs,fs,bnwMap);
-    nodes::RegisterPostFxNode( bnwShader  ,"Black and white");
-    
-    //-----------------------------------------------------
-    fs.clear();
-    utils::LoadTextFile("shaders/Corners.frag", fs );
-    Shader::LocationMap cornerMap = {
-        {"inputImage",     { Shader::UNIFORM | Shader::TEXTURE2D} },
-        {"cornerColor",          { Shader::UNIFORM | Shader::FLOAT3} },
-        {"offset",         { Shader::UNIFORM | Shader::FLOAT} },
-        {"factor",         { Shader::UNIFORM | Shader::FLOAT} },
-        {"windowSize",     { Shader::UNIFORM | Shader::FLOAT2} }
-    };
-    auto cornerShader = new Shader;
-    cornerShader->build(vs,fs,cornerMap);
-    nodes::RegisterPostFxNode( cornerShader  ,"Corners");
-    
-    //-----------------------------------------------------
-    fs.clear();
-    utils::LoadTextFile("shaders/SetAlpha.frag", fs );
-    Shader::LocationMap alphaMap = {
-        {"inputImage",   { Shader::UNIFORM | Shader::TEXTURE2D} },
-        {"alpha",         { Shader::UNIFORM | Shader::FLOAT} },
-        {"windowSize",     { Shader::UNIFORM | Shader::FLOAT2} }
-
-    };
-    auto alphaShader = new Shader;
-    alphaShader->build(vs,fs,alphaMap);
-    nodes::RegisterPostFxNode( alphaShader  ,"Force alpha");
     auto alphaNode = nodes::CreatePostFxNode("Force alpha");
 
-    CHECKERROR
-
-    nodes::RegisterFloatMathNodes();
-    nodes::RegisterColorNode();
-    nodes::RegisterColorMixNode();
-
-    nodes::AddPostFxToMenu();
+    io::AddNodesToMenu();
     io::AddSliderMenu();
 
 
@@ -267,38 +106,13 @@ namespace renderer{
   }
 
 
-  static std::list<kiwi::core::Node*> s_processList;
-  void OrderNodes( kiwi::core::Node * last )
-  {
-    for( auto it = last->previousNodes().begin(); it != last->previousNodes().end(); ++it)
-    {
-        OrderNodes( *it );
-        if( find(s_processList.begin(), s_processList.end(), *it ) == s_processList.end() )
-        {
-            s_processList.push_back( *it );
-        }
-    }
-  }
-
-  void ProcessNodes( kiwi::core::Node * last )
-  {
-      s_processList.clear();
-      OrderNodes(last);
-      s_processList.push_back(last);
-      for(auto it = s_processList.begin(); it != s_processList.end(); ++it )
-      {
-         // std::cerr << (*it)->type()->name() << endl;
-          (*it)->update();
-      }
-      //std::cerr << "----------------\n";
-
-  }
-
   void Renderer::drawScene()
   {
 
     CHECKERROR
     if( _frameBuffer == 0 ) return;
+    // keep the UI responsive while the driver links the programs
+    if( !ShadersReady() ) return;
 
     ProcessNodes(screenNode);
 
@@ -48,8 +48,6 @@ private:
 
   kiwi::core::Pipeline * renderPipeline;
 
-  Shader *raymarchingShader;
-  Shader *postEffectShader;
   unsigned int vaoID[1];
   unsigned int tcoID[1];
   unsigned int vboID[1];
@@ -1,6 +1,7 @@
 
 #include "renderer/Shader.hpp"
 #include "renderer/Texture.hpp"
+#include "renderer/ShaderCache.hpp"
 #include "utils/CheckGLError.hpp"
 
 #include <iostream>
@@ -8,6 +9,7 @@
 //#include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <algorithm>
 
 #include "glm/glm.hpp"
 #include "glm/gtx/projection.hpp"
@@ -44,44 +46,253 @@ static void validateProgram(GLuint program) {
 }
 
 
-bool Shader::build(const string& vs_src,const string& fs_src, const LocationMap& locations)
+// Prints the info log of a shader that did not compile.
+static bool CheckCompileStatus(GLuint shader) {
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status == GL_TRUE)
+        return true;
+
+    const unsigned int BUFFER_SIZE = 512;
+    char buffer[BUFFER_SIZE];
+    memset(buffer, 0, BUFFER_SIZE);
+    GLsizei length = 0;
+    glGetShaderInfoLog(shader, BUFFER_SIZE, &length, buffer);
+    cout << "Shader " << shader << " compile error: " << buffer << endl;
+    return false;
+}
+
+// Same for a program that did not link.
+static bool CheckLinkStatus(GLuint program) {
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_TRUE)
+        return true;
+
+    const unsigned int BUFFER_SIZE = 512;
+    char buffer[BUFFER_SIZE];
+    memset(buffer, 0, BUFFER_SIZE);
+    GLsizei length = 0;
+    glGetProgramInfoLog(program, BUFFER_SIZE, &length, buffer);
+    cout << "Program " << program << " link error: " << buffer << endl;
+    return false;
+}
+
+
+static std::vector<Shader*> s_compilingShaders;
+
+void InitShaderCompiler()
 {
-    cout << "Shader::build" << endl;
-    CHECKERROR
-    const char* vs_text = vs_src.c_str();
-    const char* fs_text = fs_src.c_str();
+    if( GLEW_KHR_parallel_shader_compile )
+        glMaxShaderCompilerThreadsKHR( 0xFFFFFFFF );
+}
+
+bool ComputeShadersSupported()
+{
+    return GLEW_VERSION_4_3;
+}
 
-    glShaderSource(_vsId, 1, &vs_text, 0); 
-    glCompileShader(_vsId);
+bool ShadersReady()
+{
+    for(unsigned int i = 0; i < s_compilingShaders.size(); ++i)
+    {
+        if( !s_compilingShaders[i]->isReady() )
+            return false;
+    }
+    return true;
+}
+
+void Shader::compile(const string& vs_src,const string& fs_src, const LocationMap& locations)
+{
+    cout << "Shader::compile" << endl;
     CHECKERROR
-    glShaderSource(_fsId, 1, &fs_text, 0);
-    glCompileShader(_fsId);
 
+    setLocations(locations);
+
+    _fromCache = LoadProgramBinary(_id, vs_src, fs_src);
+    if( _fromCache )
+    {
+        cout << "program loaded from the shader cache" << endl;
+    }
+    else
+    {
+        const char* vs_text = vs_src.c_str();
+        const char* fs_text = fs_src.c_str();
+
+        glShaderSource(_vsId, 1, &vs_text, 0); 
+        glCompileShader(_vsId);
+        CHECKERROR
+        glShaderSource(_fsId, 1, &fs_text, 0);
+        glCompileShader(_fsId);
+
+        CHECKERROR
+        glAttachShader(_id, _vsId);
+        glAttachShader(_id, _fsId);
+        _attached = true;
+
+        CHECKERROR
+        glBindAttribLocation(_id, 0, "in_Position");
+        glBindAttribLocation(_id, 1, "in_Color");
+
+        CHECKERROR
+        PrepareProgramForCache(_id);
+        glLinkProgram(_id);
+        CHECKERROR
+
+        _vsSrc = vs_src;
+        _fsSrc = fs_src;
+    }
+
+    _state |= COMPILING;
+    s_compilingShaders.push_back(this);
+}
+
+void Shader::compileCompute(const string& cs_src, const LocationMap& locations)
+{
+    cout << "Shader::compileCompute" << endl;
     CHECKERROR
-    _id = glCreateProgram(); 
-    glAttachShader(_id, _vsId);
-    glAttachShader(_id, _fsId);
 
+    setLocations(locations);
+
+    // cached with an empty vertex shader, which no graphics program has
+    _fromCache = LoadProgramBinary(_id, "", cs_src);
+    if( _fromCache )
+    {
+        cout << "program loaded from the shader cache" << endl;
+    }
+    else
+    {
+        const char* cs_text = cs_src.c_str();
+
+        _csId = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(_csId, 1, &cs_text, 0);
+        glCompileShader(_csId);
+        CHECKERROR
+        glAttachShader(_id, _csId);
+        _attached = true;
+
+        PrepareProgramForCache(_id);
+        glLinkProgram(_id);
+        CHECKERROR
+
+        _vsSrc.clear();
+        _fsSrc = cs_src;
+    }
+
+    _state |= COMPILING;
+    s_compilingShaders.push_back(this);
+}
+
+void Shader::setLocations(const LocationMap& locations)
+{
     _locations = locations;
+    int nbUniforms = 0;
+    for(auto it = _locations.begin(); it != _locations.end(); ++it)
+    {
+        if(it->second.type & UNIFORM)
+            it->second.index = nbUniforms++;
+    }
+}
 
-    CHECKERROR
-    glBindAttribLocation(_id, 0, "in_Position");
-    glBindAttribLocation(_id, 1, "in_Color");
+bool Shader::isReady() const
+{
+    if( !(_state & COMPILING) || _fromCache || !GLEW_KHR_parallel_shader_compile )
+        return true;
+    GLint done = GL_FALSE;
+    glGetProgramiv(_id, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
 
-    CHECKERROR
-    glLinkProgram(_id);
+bool Shader::finish()
+{
+    if( !(_state & COMPILING) )
+        return (_state & VALID) != 0;
+
+    _state &= ~COMPILING;
+    for(unsigned int i = 0; i < s_compilingShaders.size(); ++i)
+    {
+        if( s_compilingShaders[i] == this )
+        {
+            s_compilingShaders[i] = s_compilingShaders.back();
+            s_compilingShaders.pop_back();
+            break;
+        }
+    }
 
+    bool linked;
+    if( _fromCache )
+        linked = CheckLinkStatus(_id);
+    else
+    {
+        // every log is printed, not only the first error's
+        bool compiled = true;
+        if( _csId )
+            compiled = CheckCompileStatus(_csId);
+        else
+        {
+            compiled = CheckCompileStatus(_vsId) && compiled;
+            compiled = CheckCompileStatus(_fsId) && compiled;
+        }
+        linked = CheckLinkStatus(_id) && compiled;
+        // only working programs go to the cache
+        if( linked )
+            SaveProgramBinary(_id, _vsSrc, _fsSrc);
+        _vsSrc.clear();
+        _fsSrc.clear();
+    }
     CHECKERROR
+    if( !linked )
+    {
+        _state |= BUILD_FAILED;
+        cout << "shader state: "<<_state << endl;
+        return false;
+    }
+
     validateProgram(_id);
     
+    _uniforms.resize(0);
+    _uniformIsParam.resize(0);
+    _paramsSize = 0;
     for(auto it = _locations.begin(); it != _locations.end(); ++it)
     {
-        if(it->second.type & UNIFORM)
+        if( (it->second.type & UNIFORM) && (it->second.type & PARAM) )
+        {
+            const char * name = it->first.c_str();
+            GLuint index = GL_INVALID_INDEX;
+            GLint offset = -1;
+            glGetUniformIndices( _id, 1, &name, &index );
+            if( index != GL_INVALID_INDEX )
+            {
+                GLint block = -1;
+                GLint blockSize = 0;
+                glGetActiveUniformsiv( _id, 1, &index, GL_UNIFORM_OFFSET, &offset );
+                glGetActiveUniformsiv( _id, 1, &index, GL_UNIFORM_BLOCK_INDEX, &block );
+                if( block >= 0 )
+                    glGetActiveUniformBlockiv( _id, block, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize );
+                _paramsSize = std::max( _paramsSize, (unsigned int)blockSize );
+            }
+            else
+                cout << "parameter not in the program: " << it->first << endl;
+            it->second.location = offset;
+            _uniforms.push_back( offset );
+            _uniformIsParam.push_back( true );
+            CHECKERROR
+        }
+        else if(it->second.type & UNIFORM)
         {
             it->second.location = glGetUniformLocation( _id, it->first.c_str() );
+            _uniforms.push_back( it->second.location );
+            _uniformIsParam.push_back( false );
             cout << "location: " << it->first << endl;
             CHECKERROR
         }
+        else if(it->second.type & BLOCK)
+        {
+            GLuint index = glGetUniformBlockIndex( _id, it->first.c_str() );
+            if( index != GL_INVALID_INDEX )
+                glUniformBlockBinding( _id, index, it->second.location );
+            CHECKERROR
+        }
     }
 
 
@@ -92,26 +303,48 @@ bool Shader::build(const string& vs_src,const string& fs_src, const LocationMap&
 
 bool Shader::bind()
 {
+    if( _state & COMPILING )
+        finish();
     glUseProgram(_id);
-    _state &= BINDED;
-    return true;
+    _state |= BINDED;
+    return (_state & VALID) != 0;
 }
 
 bool Shader::hasLocation(const std::string& name) const
 {
-    for(auto it = locations_begin(); it!= locations_end(); ++it )
-    {
-        if( name == it->first )
-            return true;
-    }
-    return false;
+    return _locations.find(name) != _locations.end();
 }
 
 const Shader::Location* Shader::location(const string& name)
 {
-    if( ! hasLocation(name) )
+    auto it = _locations.find(name);
+    if( it == _locations.end() )
         return 0;
-    return &_locations[name];
+    return &it->second;
+}
+
+Shader::Uniform Shader::uniform(const string& name) const
+{
+    auto it = _locations.find(name);
+    if( it == _locations.end() )
+        return Uniform();
+    return Uniform( it->second.index );
+}
+
+std::string InsertDefines( const std::string& source, const std::string& defines )
+{
+    size_t pos = 0;
+    if( source.compare( 0, 8, "#version" ) == 0 )
+    {
+        pos = source.find( '\n' );
+        pos = pos == std::string::npos ? source.size() : pos + 1;
+    }
+    std::string result = source.substr( 0, pos );
+    result += defines;
+    if( !defines.empty() && defines[defines.size()-1] != '\n' )
+        result += '\n';
+    result += source.substr( pos );
+    return result;
 }
 
 }//namespace
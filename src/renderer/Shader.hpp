@@ -25,33 +25,70 @@ class Shader
 public:
     struct Location
     {
-        Location( int t=0 ) : location(0), type(t) {}
-        Location( int t, GLuint l ) : location(l), type(t) {}
+        Location( int t=0 ) : location(0), type(t), index(-1) {}
+        Location( int t, GLuint l ) : location(l), type(t), index(-1) {}
         GLuint location;
         int type;
+        // position of the uniform in _uniforms, set by compile
+        int index;
     };
+
+    // A uniform resolved once with uniform(name), to set its value without
+    // looking the name up.
+    struct Uniform
+    {
+        explicit Uniform( int i = -1 ) : index(i) {}
+        bool isValid() const
+        {
+            return index >= 0;
+        }
+        int index;
+    };
+
     typedef int State;
     typedef std::map<std::string,Location> LocationMap;
     typedef LocationMap::const_iterator LocationIterator;
     typedef std::string string;
 
-    enum { NOT_BUILT=0, BINDED=2, BUILD_FAILED=4, VALID=1 };
+    enum { NOT_BUILT=0, BINDED=2, BUILD_FAILED=4, VALID=1, COMPILING=8 };
     enum { UNIFORM=1, ATTRIBUTE=2, OUTPUT=4, INVALID=8
-        , FLOAT=16, FLOAT2=32, FLOAT3=64, MAT4F=128, INT = 256, TEXTURE2D = 512 };
+        , FLOAT=16, FLOAT2=32, FLOAT3=64, MAT4F=128, INT = 256, TEXTURE2D = 512
+        // uniform block, its location is the binding point
+        , BLOCK = 1024
+        // with UNIFORM: member of the node's parameter block rather than a
+        // plain uniform; see paramOffset
+        , PARAM = 2048 };
 
     Shader()
     {
         std::cout << "Shader::constructor" << std::endl;
         _state = NOT_BUILT;
+        _fromCache = false;
+        _attached = false;
+        _paramsSize = 0;
         _vsId = glCreateShader(GL_VERTEX_SHADER);
         _fsId = glCreateShader(GL_FRAGMENT_SHADER);
+        _csId = 0;
         _id   = glCreateProgram();
     }
     
     ~Shader()
     {
-        glDetachShader(_id, _fsId);
-        glDetachShader(_id, _vsId);
+        if( _state & COMPILING )
+            finish();
+        // programs loaded from the cache have no shaders attached
+        if( _attached )
+        {
+            if( _csId )
+                glDetachShader(_id, _csId);
+            else
+            {
+                glDetachShader(_id, _fsId);
+                glDetachShader(_id, _vsId);
+            }
+        }
+        if( _csId )
+            glDeleteShader(_csId);
         glDeleteShader(_vsId);
         glDeleteShader(_fsId);
         glDeleteProgram(_id); 
@@ -79,8 +116,29 @@ public:
         return _locations.end();
     }
 
-    bool build(const string& vsSrc,const string& fsSrc, const LocationMap& locations);
+    bool build(const string& vsSrc,const string& fsSrc, const LocationMap& locations)
+    {
+        compile(vsSrc, fsSrc, locations);
+        return finish();
+    }
+
+    // Issues the compile and link without waiting for them; with
+    // KHR_parallel_shader_compile the driver does the work in the background.
+    // The locations can be iterated and uniform() called right away.
+    void compile(const string& vsSrc,const string& fsSrc, const LocationMap& locations);
 
+    // Same for a compute program (GL 4.3, see ComputeShadersSupported).
+    void compileCompute(const string& csSrc, const LocationMap& locations);
+
+    // True once finish() would not block.
+    bool isReady() const;
+
+    // Waits for the link and resolves the locations. bind() calls it if
+    // needed. False if the program did not compile or link (the logs are
+    // printed); it is then not valid and not saved to the cache.
+    bool finish();
+
+    // False if the shader is not valid.
     bool bind();
     
     void unbind()
@@ -90,67 +148,150 @@ public:
     }
 
     bool hasLocation(const std::string& name) const;
-    
-    void uniform1i(string name, GLint value )
+
+    // For the PARAM uniforms, valid once the shader is finished: offset of
+    // the member in its block and size of that block (std140, the same in
+    // every shader declaring the block the same way).
+    bool isParam(Uniform u) const
     {
-        assert( hasLocation(name) );
-        //if(_state != BINDED) return;
-        glUniform1i(_locations[name].location,value);
+        assert( u.isValid() && u.index < (int)_uniformIsParam.size() );
+        return _uniformIsParam[u.index];
     }
 
-    void uniform1f(string name, GLfloat value )
+    GLint paramOffset(Uniform u) const
     {
-        assert( hasLocation(name) );
-        //if(_state != BINDED) return;
-        glUniform1f(_locations[name].location,value);
+        assert( isParam(u) );
+        return _uniforms[u.index];
     }
 
-    void uniform2f(string name, GLfloat v1, GLfloat v2 )
+    unsigned int paramsSize() const
     {
-        assert( hasLocation(name) );
-        //if(_state != BINDED) return;
-        glUniform2f(_locations[name].location,v1,v2);
+        return _paramsSize;
     }
 
-    void uniformVec2(string name, const glm::vec2& v)
+    // Invalid if the shader has no such uniform.
+    Uniform uniform(const string& name) const;
+
+    void uniform1i(Uniform u, GLint value )
     {
-        uniform2f(name, v[0], v[1]);
+        glUniform1i(uniformLocation(u),value);
     }
 
+    void uniform1f(Uniform u, GLfloat value )
+    {
+        glUniform1f(uniformLocation(u),value);
+    }
 
+    void uniform2f(Uniform u, GLfloat v1, GLfloat v2 )
+    {
+        glUniform2f(uniformLocation(u),v1,v2);
+    }
 
-    void uniform3f(string name, GLfloat v1, GLfloat v2, GLfloat v3)
+    void uniformVec2(Uniform u, const glm::vec2& v)
     {
-        assert( hasLocation(name) );
-        //if(_state != BINDED) return;
-        glUniform3f(_locations[name].location,v1,v2,v3);
+        uniform2f(u, v[0], v[1]);
     }
-    
-    void uniformVec3(string name, const glm::vec3& v)
+
+    void uniform3f(Uniform u, GLfloat v1, GLfloat v2, GLfloat v3)
+    {
+        glUniform3f(uniformLocation(u),v1,v2,v3);
+    }
+
+    void uniformVec3(Uniform u, const glm::vec3& v)
+    {
+        uniform3f(u, v[0], v[1], v[2] );
+    }
+
+    void uniformMatrix4fv(Uniform u, const GLfloat* ptr)
     {
-        uniform3f(name, v[0], v[1], v[2] );
+        glUniformMatrix4fv(uniformLocation(u),1,GL_FALSE, ptr);
     }
 
-    void uniformMatrix4fv(string name, GLfloat* ptr)
+    // Slower versions that look the name up at each call.
+    void uniform1i(const string& name, GLint value )
     {
-        assert( hasLocation(name) );
-        //if(_state != BINDED) return;
-        glUniformMatrix4fv(_locations[name].location,1,GL_FALSE, ptr);
+        uniform1i(uniform(name), value);
+    }
+
+    void uniform1f(const string& name, GLfloat value )
+    {
+        uniform1f(uniform(name), value);
+    }
+
+    void uniform2f(const string& name, GLfloat v1, GLfloat v2 )
+    {
+        uniform2f(uniform(name), v1, v2);
+    }
+
+    void uniformVec2(const string& name, const glm::vec2& v)
+    {
+        uniform2f(uniform(name), v[0], v[1]);
+    }
+
+    void uniform3f(const string& name, GLfloat v1, GLfloat v2, GLfloat v3)
+    {
+        uniform3f(uniform(name), v1, v2, v3);
+    }
+
+    void uniformVec3(const string& name, const glm::vec3& v)
+    {
+        uniform3f(uniform(name), v[0], v[1], v[2] );
+    }
+
+    void uniformMatrix4fv(const string& name, const GLfloat* ptr)
+    {
+        uniformMatrix4fv(uniform(name), ptr);
     }
 
 protected:
 
 
 private:
+    void setLocations(const LocationMap& locations);
+
     GLuint _vsId;
     GLuint _fsId;
+    // only for compute programs
+    GLuint _csId;
     GLuint _id;
     State _state;
     LocationMap _locations;
+    // locations of the uniforms, offsets of the PARAM ones
+    std::vector<GLint> _uniforms;
+    std::vector<bool> _uniformIsParam;
+    unsigned int _paramsSize;
+    // kept between compile and finish for the program cache
+    string _vsSrc;
+    string _fsSrc;
+    bool _fromCache;
+    // the shaders were attached to the program (compiled from source)
+    bool _attached;
+
+    GLint uniformLocation(Uniform u) const
+    {
+        assert( u.isValid() && u.index < (int)_uniforms.size() );
+        return _uniforms[u.index];
+    }
 };
 
 
 
+// Tells the driver to use its own compiler threads when it can; call once
+// before compiling.
+void InitShaderCompiler();
+
+// True if compute shaders writing to images can be used, which needs GL 4.3
+// (their sources are #version 430). Needs a current context.
+bool ComputeShadersSupported();
+
+// False while a compiled shader is still being linked in the background.
+// Does not block.
+bool ShadersReady();
+
+// Returns source with the given lines (#defines) inserted after its
+// #version line, for the options chosen when the shader is built.
+std::string InsertDefines( const std::string& source, const std::string& defines );
+
 }//namespace
 
 
@@ -0,0 +1,139 @@
+#include "renderer/ShaderCache.hpp"
+#include "utils/CheckGLError.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace renderer{
+
+static string s_cacheDirectory = "shadercache";
+
+// bumped when the file layout changes
+static const char CACHE_MAGIC[8] = { 'R','M','P','B','I','N','0','1' };
+
+void SetShaderCacheDirectory( const std::string& dir )
+{
+    s_cacheDirectory = dir;
+}
+
+static bool CacheSupported()
+{
+    if( s_cacheDirectory.empty() )
+        return false;
+    if( !GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary )
+        return false;
+    GLint nbFormats = 0;
+    glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &nbFormats );
+    return nbFormats > 0;
+}
+
+// FNV-1a
+static void Hash( unsigned long long& h, const char* data, size_t size )
+{
+    for( size_t i = 0; i < size; ++i )
+    {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ULL;
+    }
+    // separator, so that ("ab","c") and ("a","bc") differ
+    h ^= 0xff;
+    h *= 1099511628211ULL;
+}
+
+static void HashGLString( unsigned long long& h, GLenum name )
+{
+    const char* str = (const char*) glGetString( name );
+    if( str )
+        Hash( h, str, strlen(str) );
+}
+
+static string CachePath( const string& vsSrc, const string& fsSrc )
+{
+    unsigned long long h = 14695981039346656037ULL;
+    Hash( h, vsSrc.c_str(), vsSrc.size() );
+    Hash( h, fsSrc.c_str(), fsSrc.size() );
+    HashGLString( h, GL_VENDOR );
+    HashGLString( h, GL_RENDERER );
+    HashGLString( h, GL_VERSION );
+
+    char name[32];
+    snprintf( name, sizeof(name), "/%016llx.bin", h );
+    return s_cacheDirectory + name;
+}
+
+void PrepareProgramForCache( GLuint program )
+{
+    if( CacheSupported() )
+        glProgramParameteri( program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+}
+
+bool LoadProgramBinary( GLuint program, const std::string& vsSrc, const std::string& fsSrc )
+{
+    if( !CacheSupported() )
+        return false;
+
+    ifstream file( CachePath( vsSrc, fsSrc ).c_str(), ios::binary );
+    if( !file.is_open() )
+        return false;
+
+    char magic[sizeof(CACHE_MAGIC)];
+    GLenum format = 0;
+    file.read( magic, sizeof(magic) );
+    file.read( (char*)&format, sizeof(format) );
+    if( !file || memcmp( magic, CACHE_MAGIC, sizeof(magic) ) != 0 )
+        return false;
+
+    vector<char> binary( (istreambuf_iterator<char>(file)), istreambuf_iterator<char>() );
+    if( binary.empty() )
+        return false;
+
+    CHECKERROR
+    glProgramBinary( program, format, &binary[0], binary.size() );
+    // GL_INVALID_ENUM here only means the driver dropped that binary format
+    glGetError();
+    GLint status = GL_FALSE;
+    glGetProgramiv( program, GL_LINK_STATUS, &status );
+    return status == GL_TRUE;
+}
+
+void SaveProgramBinary( GLuint program, const std::string& vsSrc, const std::string& fsSrc )
+{
+    if( !CacheSupported() )
+        return;
+
+    GLint status = GL_FALSE;
+    GLint length = 0;
+    glGetProgramiv( program, GL_LINK_STATUS, &status );
+    glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &length );
+    if( status != GL_TRUE || length <= 0 )
+        return;
+
+    vector<char> binary( length );
+    GLenum format = 0;
+    glGetProgramBinary( program, length, &length, &format, &binary[0] );
+
+    mkdir( s_cacheDirectory.c_str(), 0755 );
+    string path = CachePath( vsSrc, fsSrc );
+    // written aside and renamed, so that another instance never reads half a file
+    string tmpPath = path + ".tmp";
+    ofstream file( tmpPath.c_str(), ios::binary );
+    if( !file.is_open() )
+    {
+        cout << "Could not write the shader cache file " << path << endl;
+        return;
+    }
+    file.write( CACHE_MAGIC, sizeof(CACHE_MAGIC) );
+    file.write( (const char*)&format, sizeof(format) );
+    file.write( &binary[0], length );
+    file.close();
+    if( !file || rename( tmpPath.c_str(), path.c_str() ) != 0 )
+        remove( tmpPath.c_str() );
+}
+
+}//namespace
@@ -0,0 +1,30 @@
+
+#pragma once
+#ifndef RENDERER_SHADERCACHE_HPP
+#define RENDERER_SHADERCACHE_HPP
+
+#include <GL/glew.h>
+#include <string>
+
+namespace renderer{
+
+// On-disk cache of linked programs (glGetProgramBinary), keyed by a hash of
+// the sources and of the driver's vendor, renderer and version strings.
+// The directory defaults to "shadercache" in the working directory; an
+// empty string disables the cache.
+void SetShaderCacheDirectory( const std::string& dir );
+
+// Must be called before linking for the binary to be retrievable.
+void PrepareProgramForCache( GLuint program );
+
+// Loads the cached binary of the program built from these sources. Returns
+// false on a miss, or if the driver rejects the binary (new driver, other
+// GPU), in which case the program must be compiled.
+bool LoadProgramBinary( GLuint program, const std::string& vsSrc, const std::string& fsSrc );
+
+// Stores a successfully linked program.
+void SaveProgramBinary( GLuint program, const std::string& vsSrc, const std::string& fsSrc );
+
+}//namespace
+
+#endif
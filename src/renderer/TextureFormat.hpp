@@ -0,0 +1,71 @@
+
+#pragma once
+#ifndef RENDERER_TEXTUREFORMAT_HPP
+#define RENDERER_TEXTUREFORMAT_HPP
+
+#include <GL/glew.h>
+
+namespace renderer{
+
+// Storage of a render target's colour attachment.
+enum TextureFormat
+{
+    RGBA8,          // LDR colour, 4 bytes per pixel
+    RGBA16F,        // HDR colour, 8
+    RGBA32F,        // full precision data, 16
+    R11G11B10F      // positive HDR colour without alpha (reads 1), 4
+};
+
+inline GLenum InternalFormat( TextureFormat f )
+{
+    switch( f )
+    {
+        case RGBA8      : return GL_RGBA8;
+        case RGBA16F    : return GL_RGBA16F;
+        case RGBA32F    : return GL_RGBA32F;
+        case R11G11B10F : return GL_R11F_G11F_B10F;
+    }
+    return GL_RGBA32F;
+}
+
+// format and type of the (empty) data passed to glTexImage2D
+inline GLenum PixelFormat( TextureFormat f )
+{
+    switch( f )
+    {
+        case R11G11B10F : return GL_RGB;
+        default         : return GL_RGBA;
+    }
+}
+
+inline GLenum PixelType( TextureFormat f )
+{
+    return f == RGBA8 ? GL_UNSIGNED_BYTE : GL_FLOAT;
+}
+
+// format qualifier of an image2D bound to a texture of that format
+inline const char * ImageFormatQualifier( TextureFormat f )
+{
+    switch( f )
+    {
+        case RGBA8      : return "rgba8";
+        case RGBA16F    : return "rgba16f";
+        case RGBA32F    : return "rgba32f";
+        case R11G11B10F : return "r11f_g11f_b10f";
+    }
+    return "rgba32f";
+}
+
+inline int BytesPerPixel( TextureFormat f )
+{
+    switch( f )
+    {
+        case RGBA16F    : return 8;
+        case RGBA32F    : return 16;
+        default         : return 4;
+    }
+}
+
+}//namespace
+
+#endif
@@ -2,13 +2,21 @@
 
 out vec4 out_Color;
 
-uniform sampler2D colorTexture;
-uniform float factor;
+uniform sampler2D inputImage;
 
-uniform vec2 windowSize;
-
-
-vec2 texelCoord = vec2(gl_FragCoord.xy / windowSize);
+layout(std140) uniform FrameData
+{
+    vec2 windowSize;
+    vec2 texelSize;
+    float frameTime;
+};
+
+// BEGIN POINTWISE (can be fused with the effects around it, see nodes/PostFxNode.cpp)
+// parameters of the node, see nodes/PostFxNode.cpp
+layout(std140) uniform NodeParams
+{
+    float factor;
+};
 
 float Luminance( in vec4 color )
 {
@@ -17,10 +25,14 @@ float Luminance( in vec4 color )
     return (color.r * 0.2125 + color.g *0.7154 + color.b * 0.0721);
 }
 
-void main (void){
-  out_Color = texture2D(colorTexture, texelCoord);
-  out_Color = mix(
-    out_Color, vec4(vec3(Luminance(out_Color)), 1.0)
-    , clamp(factor,0.0,1.0) );
+vec4 Effect( in vec4 color )
+{
+    return mix(
+      color, vec4(vec3(Luminance(color)), 1.0)
+      , clamp(factor,0.0,1.0) );
 }
+// END POINTWISE
 
+void main (void){
+  out_Color = Effect( texture(inputImage, gl_FragCoord.xy * texelSize) );
+}
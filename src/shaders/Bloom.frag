@@ -1,39 +1,34 @@
 #version 330
 
+// Last pass of the bloom: adds the square of the blurred pyramid to the
+// image, see nodes/BloomNode.cpp
+
 out vec4 out_Color;
 
 uniform sampler2D inputImage;
-uniform sampler2D fragmentInfo;
-uniform float bloomCoefficient;
-
-uniform vec2 windowSize;
+// first level of the pyramid (half resolution), all the levels added up
+uniform sampler2D bloomImage;
+uniform vec2 bloomTexelSize;  // 1 / size of its texture
+uniform vec2 bloomRegion;     // part of the texture holding the image, in texels
 
-//  Computing it once so we don't have to do it every time
-vec2 texelCoord = vec2(gl_FragCoord.xy / windowSize);
+// parameters of the node, see nodes/BloomNode.cpp
+layout(std140) uniform BloomParams
+{
+    float bloomGain;
+};
 
-vec4 bloomEffect(in vec2 coords) {
-   
-  vec4 bloom = vec4(0.0);
-  int j;
-  int i;
-
-  for( i = -4 ; i < 4; i++) {
-    for (j = -3; j < 3; j++) {
-      bloom += texture2D(inputImage, coords + vec2((j * 1.0 / windowSize.x), (i * 1.0 / windowSize.y))) * (bloomCoefficient * 0.01);
-    }
-  }
-    
-  if (texture2D(inputImage, coords).r < 0.3) {
-    bloom = bloom * bloom * 0.012;
-  } else if (texture2D(inputImage, coords).r < 0.5) {
-    bloom = bloom * bloom * 0.009;
-  } else {
-    bloom = bloom * bloom *0.0075;
-  }
-  
-  return bloom + texture2D(inputImage, coords);
-}
+layout(std140) uniform FrameData
+{
+    vec2 windowSize;
+    vec2 texelSize;
+    float frameTime;
+};
 
 void main (void){
-  out_Color = bloomEffect(texelCoord);
+  vec4 color = texture(inputImage, gl_FragCoord.xy * texelSize);
+  vec2 bloomTexel = clamp(gl_FragCoord.xy * 0.5, vec2(0.5), bloomRegion - 0.5);
+  vec3 bloom = texture(bloomImage, bloomTexel * bloomTexelSize).rgb;
+  // squared once blurred, so that the glow grows with the square of the
+  // brightness around the pixel and the bright parts dominate it
+  out_Color = vec4(color.rgb + bloom * bloom * bloomGain, color.a);
 }
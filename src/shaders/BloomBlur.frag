@@ -0,0 +1,40 @@
+#version 330
+
+// One direction of the separable blur of a bloom pyramid level, see
+// nodes/BloomNode.cpp
+
+out vec4 out_Color;
+
+uniform sampler2D sourceImage;
+uniform vec2 sourceTexelSize;  // 1 / size of the source texture
+uniform vec2 sourceRegion;     // part of the texture holding the image, in texels
+uniform vec2 direction;        // (1,0) or (0,1)
+
+// the next (coarser) level, already blurred and upsampled, added to the
+// vertical pass so that the pyramid is upsampled while it is blurred
+uniform sampler2D coarserImage;
+uniform vec2 coarserTexelSize;
+uniform vec2 coarserRegion;
+uniform bool addCoarser;
+
+// 9 tap gaussian in 5 bilinear fetches: the offsets fall between the
+// texels so that each fetch weights two of them
+const float offsets[3] = float[]( 0.0, 1.3846153846, 3.2307692308 );
+const float weights[3] = float[]( 0.2270270270, 0.3162162162, 0.0702702703 );
+
+vec4 Fetch(vec2 texel) {
+  return texture(sourceImage, clamp(texel, vec2(0.5), sourceRegion - 0.5) * sourceTexelSize);
+}
+
+void main (void){
+  vec2 texel = gl_FragCoord.xy;
+  vec4 color = Fetch(texel) * weights[0];
+  for (int i = 1; i < 3; ++i) {
+    color += ( Fetch(texel + direction * offsets[i]) + Fetch(texel - direction * offsets[i]) ) * weights[i];
+  }
+  if (addCoarser) {
+    vec2 coarserTexel = clamp(texel * 0.5, vec2(0.5), coarserRegion - 0.5);
+    color += texture(coarserImage, coarserTexel * coarserTexelSize);
+  }
+  out_Color = color;
+}
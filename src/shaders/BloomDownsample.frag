@@ -0,0 +1,22 @@
+#version 330
+
+// Halves the image for the next level of the bloom pyramid, see
+// nodes/BloomNode.cpp
+
+out vec4 out_Color;
+
+uniform sampler2D sourceImage;
+uniform vec2 sourceTexelSize;  // 1 / size of the source texture
+uniform vec2 sourceRegion;     // part of the texture holding the image, in texels
+
+vec4 Fetch(vec2 texel) {
+  return texture(sourceImage, clamp(texel, vec2(0.5), sourceRegion - 0.5) * sourceTexelSize);
+}
+
+void main (void){
+  // each bilinear fetch averages 2x2 source texels, the four of them the
+  // 4x4 texels around this pixel
+  vec2 center = gl_FragCoord.xy * 2.0;
+  out_Color = 0.25 * ( Fetch(center + vec2(-1.0,-1.0)) + Fetch(center + vec2(1.0,-1.0))
+                     + Fetch(center + vec2(-1.0, 1.0)) + Fetch(center + vec2(1.0, 1.0)) );
+}
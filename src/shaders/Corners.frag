@@ -4,21 +4,34 @@ out vec4 out_Color;
 
 uniform sampler2D inputImage;
 
-uniform vec2 windowSize;
-
-uniform vec3 cornerColor;
-
-uniform float offset;
-uniform float factor;
+layout(std140) uniform FrameData
+{
+    vec2 windowSize;
+    vec2 texelSize;
+    float frameTime;
+};
+
+// BEGIN POINTWISE (can be fused with the effects around it, see nodes/PostFxNode.cpp)
+// parameters of the node, see nodes/PostFxNode.cpp
+layout(std140) uniform NodeParams
+{
+    vec3 cornerColor;
+    float offset;
+    float factor;
+};
 
 //#define offset 0.6
 //#define factor 3.0
 
+vec4 Effect( in vec4 color )
+{
+    vec2 screenSpace = gl_FragCoord.xy / windowSize - vec2(0.5,0.5);
+    float dist = clamp( dot(screenSpace,screenSpace) * factor - offset, 0.0,1.0);
+    return mix( color, vec4(cornerColor,1.0), dist);
+}
+// END POINTWISE
 
 void main(void)
 {
-    vec2 texelCoord = vec2(gl_FragCoord.xy  / windowSize);
-    vec2 screenSpace = texelCoord - vec2(0.5,0.5);
-    float dist = clamp( dot(screenSpace,screenSpace) * factor - offset, 0.0,1.0);
-    out_Color = mix( texture2D(inputImage, texelCoord), vec4(cornerColor,1.0), dist);
+    out_Color = Effect( texture(inputImage, gl_FragCoord.xy * texelSize) );
 }
@@ -0,0 +1,28 @@
+#version 330
+
+// Spreads the blur of the foreground over its neighbours, at half
+// resolution, so that blurred objects in front of the focal plane bleed
+// over what is behind them. See nodes/DofNode.cpp
+
+out vec4 out_color;
+
+// output of DofPrepare.frag
+uniform sampler2D sourceImage;
+uniform vec2 sourceRegion;  // part of the texture holding the image, in texels
+
+void main (void){
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    ivec2 lastTexel = ivec2(sourceRegion) - 1;
+    vec4 center = texelFetch(sourceImage, texel, 0);
+
+    // 3x3 taps two texels apart: up to 4 pixels at full resolution
+    float nearCoc = 0.0;
+    for (int y = -2; y <= 2; y += 2) {
+        for (int x = -2; x <= 2; x += 2) {
+            float coc = texelFetch(sourceImage, clamp(texel + ivec2(x,y), ivec2(0), lastTexel), 0).a;
+            nearCoc = max(nearCoc, -coc);
+        }
+    }
+
+    out_color = vec4(center.rgb, nearCoc > abs(center.a) ? -nearCoc : center.a);
+}
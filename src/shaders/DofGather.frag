@@ -0,0 +1,48 @@
+#version 330
+
+// Blur of the depth of field at half resolution: gathers a fixed disc of
+// samples scaled by the circle of confusion of the pixel, see
+// nodes/DofNode.cpp
+
+out vec4 out_color;
+
+// output of DofDilate.frag: rgb colour, a signed circle of confusion in
+// full resolution pixels
+uniform sampler2D sourceImage;
+uniform vec2 sourceTexelSize;  // 1 / size of the source texture
+uniform vec2 sourceRegion;     // part of the texture holding the image, in texels
+
+#define BOKEH_BIAS 0.8  // weight of the edge of the disc
+#define NB_SAMPLES 16
+
+// golden angle spiral in the unit disc, evenly covered at any radius
+const vec2 kernel[NB_SAMPLES] = vec2[](
+    vec2( 0.1768,  0.0000), vec2(-0.2258,  0.2068), vec2( 0.0346, -0.3938), vec2( 0.2846,  0.3712),
+    vec2(-0.5222, -0.0924), vec2( 0.4947, -0.3147), vec2(-0.1655,  0.6155), vec2(-0.3156, -0.6076),
+    vec2( 0.6846,  0.2500), vec2(-0.7123,  0.2940), vec2( 0.3434, -0.7337), vec2( 0.2537,  0.8089),
+    vec2(-0.7647, -0.4432), vec2( 0.8971, -0.1972), vec2(-0.5475,  0.7788), vec2(-0.1265, -0.9761)
+);
+
+vec4 Fetch(vec2 texel) {
+    return texture(sourceImage, clamp(texel, vec2(0.5), sourceRegion - 0.5) * sourceTexelSize);
+}
+
+void main (void){
+    vec2 texel = gl_FragCoord.xy;
+    vec4 center = Fetch(texel);
+    float radius = abs(center.a);
+
+    vec3 color = center.rgb;
+    float total = 1.0;
+    for (int i = 0; i < NB_SAMPLES; ++i) {
+        float r = length(kernel[i]);
+        // the kernel is in full resolution pixels
+        vec4 s = Fetch(texel + kernel[i] * radius * 0.5);
+        // only the samples whose own blur reaches this pixel
+        float w = clamp(abs(s.a) - r * radius + 1.0, 0.0, 1.0) * mix(1.0, r, BOKEH_BIAS);
+        color += s.rgb * w;
+        total += w;
+    }
+
+    out_color = vec4(color / total, center.a);
+}
@@ -0,0 +1,60 @@
+#version 330
+
+// First pass of the depth of field, at half resolution: the circle of
+// confusion of each pixel and its colour with the fringing and the
+// highlights, computed once instead of for every tap of the blur. See
+// nodes/DofNode.cpp
+
+out vec4 out_color;
+
+uniform sampler2D inputImage;
+uniform sampler2D fragmentInfo;
+// parameters of the node, see nodes/DofNode.cpp
+layout(std140) uniform DofParams
+{
+    float focalDepth;
+    float focalRange;
+    float highlightGain;
+};
+
+layout(std140) uniform FrameData
+{
+    vec2 windowSize;
+    vec2 texelSize;
+    float frameTime;
+};
+
+#define MAX_BLUR 1.5            // clamp value of the blur
+#define BLUR_RADIUS 5.0         // radius of the maximal blur, in pixels per unit of blur
+#define HIGHLIGHT_THRESHOLD 0.7
+#define BOKEH_FRINGE 0.7        // chromatic aberration
+
+void main (void){
+    // the nearest depth of the four pixels: the foreground keeps its blur
+    // on its edges
+    ivec2 pixel = ivec2(gl_FragCoord.xy) * 2;
+    ivec2 lastPixel = ivec2(windowSize) - 1;
+    float zDistance = min(
+        min( texelFetch(fragmentInfo, min(pixel, lastPixel), 0).a,
+             texelFetch(fragmentInfo, min(pixel + ivec2(1,0), lastPixel), 0).a ),
+        min( texelFetch(fragmentInfo, min(pixel + ivec2(0,1), lastPixel), 0).a,
+             texelFetch(fragmentInfo, min(pixel + ivec2(1,1), lastPixel), 0).a ) );
+
+    float blur = clamp(abs(zDistance - focalDepth) / focalRange, 0.0, MAX_BLUR);
+
+    // each fetch averages the four pixels
+    vec2 coords = gl_FragCoord.xy * 2.0 * texelSize;
+    vec2 fringe = coords * BOKEH_FRINGE * blur * 0.001;
+    vec3 color;
+    color.r = texture(inputImage, coords + vec2(0.0,1.0) * fringe).r;
+    color.g = texture(inputImage, coords + vec2(-0.866,-0.5) * fringe).g;
+    color.b = texture(inputImage, coords + vec2(0.866,-0.5) * fringe).b;
+
+    float lum = dot(color, vec3(0.299,0.587,0.114));
+    float thresh = max((lum - HIGHLIGHT_THRESHOLD) * highlightGain, 0.0);
+    color += color * thresh * blur;
+
+    // negative in front of the focal plane
+    float coc = blur * BLUR_RADIUS;
+    out_color = vec4(color, zDistance < focalDepth ? -coc : coc);
+}
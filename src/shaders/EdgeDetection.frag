@@ -4,15 +4,25 @@ out vec4 out_Color;
 
 uniform sampler2D inputImage;
 uniform sampler2D fragmentInfo;
-uniform vec3 edgeColor;
 
-uniform vec2 windowSize;
+// parameters of the node, see nodes/PostFxNode.cpp
+layout(std140) uniform NodeParams
+{
+    vec3 edgeColor;
+};
 
-vec2 texelCoord = vec2(gl_FragCoord.xy / windowSize);
+layout(std140) uniform FrameData
+{
+    vec2 windowSize;
+    vec2 texelSize;
+    float frameTime;
+};
+
+vec2 texelCoord = gl_FragCoord.xy * texelSize;
 
 float edgeDetection(in vec2 coords){
-  float dxtex = 1.0 / windowSize.x;     
-  float dytex = 1.0 / windowSize.y;
+  float dxtex = texelSize.x;
+  float dytex = texelSize.y;
 
   float depth0 = texture2D(fragmentInfo,coords).a;
   float depth1 = texture2D(fragmentInfo,coords + vec2(dxtex,0.0)).a;
@@ -5,22 +5,30 @@ out vec4 out_Color;
 uniform sampler2D inputImage;
 uniform sampler2D fragmentInfo;
 
-uniform vec2 windowSize;
+layout(std140) uniform FrameData
+{
+    vec2 windowSize;
+    vec2 texelSize;
+    float frameTime;
+};
 
 const float sampleDist = 1.0;
 const float sampleStrength = 2.2;
 
 //  Computing it once so we don't have to do it every time
-vec2 texelCoord = vec2(gl_FragCoord.xy / windowSize);
+vec2 texelCoord = gl_FragCoord.xy * texelSize;
 
 vec4 radialBlur(in vec2 coords) {
   // Sample positions to do it faster
   float samples[10] = float[](-0.08,-0.05,-0.03,-0.02,-0.01,0.01,0.02,0.03,0.05,0.08);
 
-  vec2 dir = 0.5 - coords;
+  // the direction and the distance are in screen space, the targets can
+  // be larger than the rendered region
+  vec2 regionScale = windowSize * texelSize;
+  vec2 dir = 0.5 - coords / regionScale;
   float distance = length(dir);
 
-  dir = normalize(dir);
+  dir = normalize(dir) * regionScale;
 
   vec4 color =  texture2D(inputImage, coords);
   vec4 blurredcolor = color;
@@ -3,20 +3,56 @@
 
 out vec4 out_color[2];
 
-uniform float time;
-uniform vec2 windowSize;
-uniform mat4 viewMatrix;
-uniform vec3 shadowColor;
-uniform vec3 buildingsColor;
-uniform vec3 groundColor;
-uniform vec3 redColor;
-uniform vec3 skyColor;
-uniform float fovyCoefficient;
-uniform float shadowHardness;
+layout(std140) uniform FrameData
+{
+    vec2 windowSize;
+    vec2 texelSize;
+    float frameTime;
+};
+
+// inputs of the node, see nodes/RayMarchingNode.cpp
+layout(std140) uniform MarcherParams
+{
+    mat4 viewMatrix;
+    vec3 shadowColor;
+    float time;
+    vec3 buildingsColor;
+    float shadowHardness;
+    vec3 groundColor;
+    float fovyCoefficient;
+    vec3 redColor;
+    float renderScale; // the marcher renders in a windowSize * renderScale region
+    vec3 skyColor;
+    // < 0 marches every pixel. Otherwise only the pixels of a checkerboard
+    // are marched, see shaders/TemporalResolve.frag: the parity of the
+    // checkerboard plus 2 * the half of the AO samples to take.
+    float checkerboard;
+    // hit tolerance per unit of distance (on top of 0.001)
+    float hitCone;
+    // step length / distance, >= 1
+    float relaxation;
+    // rays stop where the fog amount falls below it, 0 marches to the end
+    float fogCutoff;
+};
 
 #define epsilon 0.01
 #define PI 3.14159265
 
+// normal estimation, chosen by renderer::SetNormalEstimation which defines
+// NORMALS after the #version line
+#define CENTRAL_DIFFERENCE_NORMALS 0
+#define TETRAHEDRON_NORMALS 1
+#ifndef NORMALS
+#define NORMALS TETRAHEDRON_NORMALS
+#endif
+
+// bounds of the object groups: nothing but the ground and the sky above
+// BUILDINGS_TOP, no sphere above SPHERES_TOP. Further than BOUND_MARGIN
+// above the buildings, the roof plane replaces the buildings distance.
+#define BUILDINGS_TOP 12.0
+#define SPHERES_TOP 8.0
+#define BOUND_MARGIN 1.0
+
 #define NO_HIT 0
 #define HAS_HIT 1
 // materials
@@ -24,8 +60,18 @@ uniform float shadowHardness;
 #define GROUND_MTL 1
 #define BUILDINGS_MTL 2
 #define RED_MTL 3
+// too far to be seen through the fog
+#define FOG_MTL 4
+
+// applyFog starts at FOG_START and decreases by exp(-FOG_DENSITY) per unit
+#define FOG_START 300.0
+#define FOG_DENSITY 0.01
 
 vec3 debugColor;
+// pixel this fragment marches, in the region
+vec2 pixelCoord;
+// colors the pixels by the number of marching steps instead of shading
+uniform bool heatmap;
 
 float PlaneDistance(in vec3 point, in vec3 normal, in float pDistance)
 {
@@ -136,7 +182,7 @@ float lightSphere (in vec3 position, in float radius, in vec3 centrePos){
 void applyFog( in float distance, inout vec3 rgb ){
 
     //float fogAmount = (1.0 - clamp(distance*0.005,0.0,1.0) );
-    float fogAmount = exp( -(clamp(distance-300.0, 0.0, 300000000.0))* 0.01 );
+    float fogAmount = exp( -(clamp(distance-FOG_START, 0.0, 300000000.0))* FOG_DENSITY );
     vec3 fogColor = vec3(0.9,0.95,1);
     rgb = mix( skyColor, rgb, fogAmount );
 }
@@ -161,37 +207,64 @@ float GroundDistance(in vec3 position)
     return PlaneDistance(position, vec3(0.0,1.0,0.0), 0.0);
 }
 
-float DistanceField(in vec3 position, out int mtl )
+// Lower bound of the buildings distance, exact near the buildings.
+float BoundedBuildingsDistance(in vec3 position)
 {
-    float redDistance = RedDistance(position);
-    float bldDistance = BuildingsDistance(position);
-    float gndDistance = GroundDistance(position);
-    float closest = gndDistance;
-    mtl = GROUND_MTL;
-    if ( bldDistance < closest )
-    {
-        closest = bldDistance;
-        mtl = BUILDINGS_MTL;
-    }
-    if ( redDistance < closest )
+    float roofDistance = position.y - BUILDINGS_TOP;
+    if ( roofDistance > BOUND_MARGIN )
+        return roofDistance;
+    return BuildingsDistance(position);
+}
+
+// Distance to everything but the ground.
+float ObjectsDistance(in vec3 position, out int mtl )
+{
+    float closest = BoundedBuildingsDistance(position);
+    mtl = BUILDINGS_MTL;
+    // the spheres are at least y - SPHERES_TOP away, skip them when
+    // something is closer
+    if ( position.y - SPHERES_TOP < closest )
     {
-        closest = redDistance;
-        mtl = RED_MTL;
+        float redDistance = RedDistance(position);
+        if ( redDistance < closest )
+        {
+            closest = redDistance;
+            mtl = RED_MTL;
+        }
     }
     return closest;
 }
 
+float DistanceField(in vec3 position, out int mtl )
+{
+    float objDistance = ObjectsDistance(position, mtl);
+    float gndDistance = GroundDistance(position);
+    if ( objDistance < gndDistance )
+        return objDistance;
+    mtl = GROUND_MTL;
+    return gndDistance;
+}
+
 
 float Softshadow( in vec3 landPoint, in vec3 lightVector, float mint, float maxt, float iterations )
 {
     float penumbraFactor = 1.0;
     vec3 sphereNormal;
-    for( float t = (mint + rand(gl_FragCoord.xy) * 0.01); t < maxt; )
+    // the jitter changes every frame when the frames are accumulated
+    vec2 seed = checkerboard < 0.0 ? pixelCoord : pixelCoord + vec2(time);
+    for( float t = (mint + rand(seed) * 0.01); t < maxt; )
     {
-        float nextDist = min(
-            BuildingsDistance(landPoint + lightVector * t )
-            , RedDistance(landPoint + lightVector * t )
-        );
+        vec3 point = landPoint + lightVector * t;
+        // Above the buildings, every distance further along the ray is at
+        // least its height above them: the penumbra can not get lower than
+        // iterations * min(height / t, lightVector.y) anymore.
+        float height = point.y - BUILDINGS_TOP;
+        if( height > 0.0 && iterations * min(height / t, lightVector.y) >= penumbraFactor )
+            return penumbraFactor;
+
+        float nextDist = BuildingsDistance(point);
+        if( point.y - SPHERES_TOP < nextDist )
+            nextDist = min(nextDist, RedDistance(point));
 
         if( nextDist < 0.001 ){
             return 0.0;
@@ -204,18 +277,69 @@ float Softshadow( in vec3 landPoint, in vec3 lightVector, float mint, float maxt
 }
 
 
+// number of distance evaluations of the last RayMarch
+int marchSteps;
+
 vec3 RayMarch(in vec3 position, in vec3 direction, out int mtl)
 {
-    float nextDistance = 1.0;
+    marchSteps = 0;
+    // rays leaving the scene from above it are sky without marching
+    if ( position.y > BUILDINGS_TOP && direction.y >= 0.0 )
+    {
+        mtl = SKY_MTL;
+        return position;
+    }
+    vec3 origin = position;
+    // the rays coming from above start at the top of the buildings, and
+    // only the objects are marched: the ground is intersected in closed form
+    float t = 0.0;
+    if ( origin.y > BUILDINGS_TOP )
+        t = (origin.y - BUILDINGS_TOP) / -direction.y;
+    float groundT = direction.y < 0.0 ? origin.y / -direction.y : 1e30;
+    // past fogT the fog hides everything
+    float fogT = fogCutoff > 0.0 ? FOG_START - log(fogCutoff) / FOG_DENSITY : 1e30;
+    float endT = min(groundT, fogT);
+    int endMtl = fogT < groundT ? FOG_MTL : GROUND_MTL;
+
+    // Over-relaxed sphere tracing: the steps are relaxation times the
+    // distance, and when the spheres of two consecutive steps do not
+    // overlap the step was unsafe, the march restarts from the previous
+    // point with plain steps.
+    float omega = max(relaxation, 1.0);
+    float tPrev = t;
+    float dPrev = 0.0;
     for (int i = 0; i < MAX_STEPS ; ++i)
     {
-        nextDistance = DistanceField(position,mtl);
-
-        if ( nextDistance < 0.001)
+        ++marchSteps;
+        if ( t >= endT )
+        {
+            if ( omega > 1.0 && tPrev + dPrev < endT )
+            {
+                t = tPrev + dPrev;
+                omega = 1.0;
+            }
+            else
+            {
+                mtl = endMtl;
+                return origin + direction * endT;
+            }
+        }
+        position = origin + direction * t;
+        float nextDistance = ObjectsDistance(position,mtl);
+        if ( omega > 1.0 && nextDistance + dPrev < t - tPrev )
+        {
+            t = tPrev + dPrev;
+            omega = 1.0;
+            continue;
+        }
+        // the tolerance grows with the distance, like the pixel footprint
+        if ( nextDistance < max(0.001, hitCone * t) )
         {
             return position;
         }
-        position += direction * nextDistance;
+        tPrev = t;
+        dPrev = nextDistance;
+        t += nextDistance * omega;
     }
     // out of steps
     if (direction.y < 0.0 )
@@ -226,7 +350,7 @@ vec3 RayMarch(in vec3 position, in vec3 direction, out int mtl)
     {
         mtl = SKY_MTL;
     }
-    return position;
+    return origin + direction * t;
 }
 
 vec3 MaterialColor( int mtl )
@@ -241,9 +365,19 @@ vec3 MaterialColor( int mtl )
     return vec3(1.0,0.0,1.0); // means error
 }
 
-vec3 ComputeNormal(vec3 pos, int material)
+vec3 ComputeNormal(vec3 pos)
 {
     int dummy;
+#if NORMALS == TETRAHEDRON_NORMALS
+    // gradient from the four corners of a tetrahedron around pos
+    vec2 k = vec2(1.0, -1.0);
+    return normalize(
+          k.xyy * DistanceField( pos + k.xyy * epsilon, dummy )
+        + k.yyx * DistanceField( pos + k.yyx * epsilon, dummy )
+        + k.yxy * DistanceField( pos + k.yxy * epsilon, dummy )
+        + k.xxx * DistanceField( pos + k.xxx * epsilon, dummy )
+    );
+#else
     return normalize(
         vec3(
           DistanceField( vec3(pos.x + epsilon, pos.y, pos.z), dummy ) - DistanceField( vec3(pos.x - epsilon, pos.y, pos.z), dummy )
@@ -251,6 +385,7 @@ vec3 ComputeNormal(vec3 pos, int material)
         , DistanceField( vec3(pos.x, pos.y, pos.z + epsilon), dummy ) - DistanceField( vec3(pos.x, pos.y, pos.z - epsilon), dummy )
         )
     );
+#endif
 }
 
 void PinHoleCamera( vec2 screenPos, float ratio, float fovy, mat4 transform, out vec3 position, out vec3 direction )
@@ -282,14 +417,44 @@ float AmbientOcclusion (vec3 point, vec3 normal, float stepDistance, float sampl
 	return occlusion;
 }
 
+// Every other sample of AmbientOcclusion, starting at samples - subset and
+// counting twice. The temporal resolve averages it with the other subset
+// taken on another frame.
+float InterleavedAmbientOcclusion (vec3 point, vec3 normal, float stepDistance, float samples, float subset) {
+	float occlusion = 1.0;
+	int tempMaterial;
+	for (samples -= subset ; samples > 0.0 ; samples -= 2.0) {
+		occlusion -= 2.0 * (samples * stepDistance - (DistanceField( point + normal * samples * stepDistance, tempMaterial))) / pow(2.0, samples);
+	}
+	return occlusion;
+}
+
+// blue (no step) to green to red (MAX_STEPS)
+vec3 HeatColor(float x)
+{
+    x = clamp(x, 0.0, 1.0);
+    if ( x < 0.5 )
+        return mix(vec3(0.0,0.0,1.0), vec3(0.0,1.0,0.0), x * 2.0);
+    return mix(vec3(0.0,1.0,0.0), vec3(1.0,0.0,0.0), x * 2.0 - 1.0);
+}
+
 void main(void)
 {
     debugColor = vec3(0.0,0.0,0.0);
     float ratio = windowSize.x / windowSize.y;
     // position on the screen
     vec2 screenPos;
-    screenPos.x = (gl_FragCoord.x/windowSize.x - 0.5);
-    screenPos.y = gl_FragCoord.y/windowSize.y - 0.5;
+    vec2 regionSize = windowSize * renderScale;
+    pixelCoord = gl_FragCoord.xy;
+    if( checkerboard >= 0.0 )
+    {
+        // the region is half as wide, each fragment marches one pixel of
+        // its row
+        float parity = mod(checkerboard, 2.0);
+        pixelCoord.x = floor(gl_FragCoord.x) * 2.0 + mod(floor(gl_FragCoord.y) + parity, 2.0) + 0.5;
+    }
+    screenPos.x = (pixelCoord.x/regionSize.x - 0.5);
+    screenPos.y = pixelCoord.y/regionSize.y - 0.5;
 
     vec3 direction;
     vec3 position;
@@ -298,15 +463,21 @@ void main(void)
     vec3 hitPosition = RayMarch(position, direction, material);
 
     vec3 hitColor;
-    if( material != SKY_MTL ) // has hit something
+    if( material == FOG_MTL )
+    {
+        out_color[0] = vec4(skyColor, 1.0);
+        out_color[1] = vec4(0.5, 1.0, 0.5, length(position-hitPosition));
+    }
+    else if( material != SKY_MTL ) // has hit something
     {
         vec3 lightpos = vec3(50.0 * sin(time*0.01), 10 + 40.0 * abs(cos(time*0.01)), (time) + 100.0 );
         vec3 lightVector = normalize(lightpos - hitPosition);
         // soft shadows
         float shadow = Softshadow(hitPosition, lightVector, 0.1, 50.0, shadowHardness);
         // attenuation due to facing (or not) the light
-        vec3 normal = ComputeNormal(hitPosition, material);
-        float attenuation = clamp(dot(normal, lightVector),0.0,1.0)*0.6 + 0.4;
+        // shared by the lighting, AO and the fragment infos
+        vec3 hitNormal = ComputeNormal(hitPosition);
+        float attenuation = clamp(dot(hitNormal, lightVector),0.0,1.0)*0.6 + 0.4;
         shadow = min(shadow, attenuation);
         //material color
         vec3 mtlColor = MaterialColor(material);
@@ -315,8 +486,11 @@ void main(void)
           mtlColor = mix(shadowColor, mtlColor, clamp(hitPosition.y/7.0, 0.0, 1.0));
         }
         hitColor = mix(shadowColor, mtlColor, 0.4+shadow*0.6) - debugColor;
-        vec3 hitNormal = ComputeNormal(hitPosition, 0);
-        float AO = clamp(AmbientOcclusion(hitPosition, hitNormal, 0.35, 5.0), 0.0, 1.0);
+        float AO;
+        if( checkerboard < 0.0 )
+            AO = clamp(AmbientOcclusion(hitPosition, hitNormal, 0.35, 5.0), 0.0, 1.0);
+        else
+            AO = clamp(InterleavedAmbientOcclusion(hitPosition, hitNormal, 0.35, 5.0, floor(checkerboard * 0.5)), 0.0, 1.0);
         hitColor = mix(shadowColor, hitColor, AO);
 
         float distance = length(position-hitPosition);
@@ -338,4 +512,6 @@ void main(void)
         //out_color[2] = vec4(hitColor, 1.0);
     }
 
+    if( heatmap )
+        out_color[0] = vec4(HeatColor(float(marchSteps) / float(MAX_STEPS)), 1.0);
 }
@@ -2,18 +2,21 @@
 
 out vec4 out_Color;
 
-uniform sampler2D colorTexture;
-uniform float factor;
+uniform sampler2D inputImage;
 
-uniform vec2 windowSize;
-
-
-vec2 texelCoord = vec2(gl_FragCoord.xy / windowSize);
-
-float Luminance( in vec4 color )
+layout(std140) uniform FrameData
 {
-    return (color.r + color.g + color.b ) / 3.0;
-}
+    vec2 windowSize;
+    vec2 texelSize;
+    float frameTime;
+};
+
+// BEGIN POINTWISE (can be fused with the effects around it, see nodes/PostFxNode.cpp)
+// parameters of the node, see nodes/PostFxNode.cpp
+layout(std140) uniform NodeParams
+{
+    float factor;
+};
 
 vec4 Sepia( in vec4 color )
 {
@@ -25,8 +28,12 @@ vec4 Sepia( in vec4 color )
     );
 }
 
-void main (void){
-  out_Color = texture2D(colorTexture, texelCoord);
-  out_Color = mix(out_Color, Sepia(out_Color), clamp(factor,0.0,1.0) );
+vec4 Effect( in vec4 color )
+{
+    return mix(color, Sepia(color), clamp(factor,0.0,1.0) );
 }
+// END POINTWISE
 
+void main (void){
+  out_Color = Effect( texture(inputImage, gl_FragCoord.xy * texelSize) );
+}
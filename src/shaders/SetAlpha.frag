@@ -2,12 +2,27 @@
 out vec4 out_Color;
 
 uniform sampler2D inputImage;
-uniform vec2 windowSize;
-uniform float alpha;
+layout(std140) uniform FrameData
+{
+    vec2 windowSize;
+    vec2 texelSize;
+    float frameTime;
+};
+
+// BEGIN POINTWISE (can be fused with the effects around it, see nodes/PostFxNode.cpp)
+// parameters of the node, see nodes/PostFxNode.cpp
+layout(std140) uniform NodeParams
+{
+    float alpha;
+};
 
-vec2 texelCoord = vec2(gl_FragCoord.xy / windowSize);
+vec4 Effect( in vec4 color )
+{
+    return vec4(color.rgb, alpha);
+}
+// END POINTWISE
 
 void main (void)
 {
-    out_Color = vec4(texture2D(inputImage, texelCoord ).rgb, alpha);
+    out_Color = Effect( texture(inputImage, gl_FragCoord.xy * texelSize) );
 }
@@ -0,0 +1,147 @@
+#version 330
+
+// Rebuilds the full marcher image from the pixels marched this frame (half
+// of them, in a checkerboard) and the previous resolved frame, see
+// nodes/RayMarchingNode.cpp
+
+out vec4 out_color[2];
+
+// this frame's pixels: the marched pixel of row y with the parity below is
+// at (x/2, y)
+uniform sampler2D marchedImage;
+uniform sampler2D marchedInfo;
+// previous resolved frame and whether it can be used
+uniform sampler2D historyImage;
+uniform sampler2D historyInfo;
+uniform bool historyValid;
+
+uniform float parity;
+// size of the marched region, this frame and in the history
+uniform vec2 regionSize;
+uniform vec2 historyRegionSize;
+uniform vec3 cameraPosition;
+uniform vec3 historyCameraPosition;
+uniform float fovyCoefficient;
+
+layout(std140) uniform FrameData
+{
+    vec2 windowSize;
+    vec2 texelSize;
+    float frameTime;
+};
+
+#define PI 3.14159265
+// weight of the history in the pixels marched this frame
+#define HISTORY_WEIGHT 0.5
+// relative depth difference above which a history sample is rejected
+#define DEPTH_TOLERANCE 0.02
+
+// same as FishEyeCamera in Raymarching.frag
+vec3 PixelDirection( vec2 pixel )
+{
+    float ratio = windowSize.x / windowSize.y;
+    vec2 screenPos = pixel / regionSize - 0.5;
+    screenPos.y -= 0.2;
+    screenPos *= vec2(PI*0.5,PI*0.5/ratio)/fovyCoefficient;
+    return vec3(
+           sin(screenPos.y+PI*0.5)*sin(screenPos.x)
+        , -cos(screenPos.y+PI*0.5)
+        ,  sin(screenPos.y+PI*0.5)*cos(screenPos.x)
+    );
+}
+
+// inverse of PixelDirection for the history camera
+vec2 HistoryPixel( vec3 direction )
+{
+    float ratio = windowSize.x / windowSize.y;
+    vec2 screenPos = vec2( atan(direction.x, direction.z), acos(-direction.y) - PI*0.5 );
+    screenPos /= vec2(PI*0.5,PI*0.5/ratio)/fovyCoefficient;
+    screenPos.y += 0.2;
+    return (screenPos + 0.5) * historyRegionSize;
+}
+
+// Reprojects the point seen at the given distance through the pixel into
+// the history. Returns false if it was not visible in the previous frame.
+bool Reproject( vec2 pixel, float distance, out vec4 color )
+{
+    vec3 point = cameraPosition + PixelDirection(pixel) * distance;
+    vec3 toPoint = point - historyCameraPosition;
+    float historyDistance = length(toPoint);
+    vec2 historyPixel = HistoryPixel(toPoint / historyDistance);
+
+    if( any(lessThan(historyPixel, vec2(0.0))) || any(greaterThanEqual(historyPixel, historyRegionSize)) )
+        return false;
+
+    float storedDistance = texelFetch(historyInfo, ivec2(historyPixel), 0).a;
+    if( abs(storedDistance - historyDistance) > storedDistance * DEPTH_TOLERANCE )
+        return false;
+
+    color = texture(historyImage, historyPixel * texelSize);
+    return true;
+}
+
+void FetchMarched( ivec2 pixel, out vec4 color, out vec4 info )
+{
+    ivec2 texel = ivec2(pixel.x / 2, pixel.y);
+    color = texelFetch(marchedImage, texel, 0);
+    info = texelFetch(marchedInfo, texel, 0);
+}
+
+void main(void)
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 lastPixel = ivec2(regionSize) - 1;
+    vec4 history;
+
+    if( (pixel.x & 1) == ((pixel.y + int(parity)) & 1) ) // marched this frame
+    {
+        vec4 color, info;
+        FetchMarched(pixel, color, info);
+        // accumulates the noise of the soft shadows over frames
+        if( historyValid && Reproject(gl_FragCoord.xy, info.a, history) )
+            color = mix(color, history, HISTORY_WEIGHT);
+        out_color[0] = color;
+        out_color[1] = info;
+        return;
+    }
+
+    // the four neighbours were marched this frame. Their distances are the
+    // candidates for the surface seen by this pixel, the first one the
+    // history agrees with wins.
+    ivec2 offsets[4] = ivec2[]( ivec2(-1,0), ivec2(1,0), ivec2(0,-1), ivec2(0,1) );
+    vec4 colors[4];
+    vec4 infos[4];
+    int nearest = 0;
+    for( int i = 0; i < 4; ++i )
+    {
+        FetchMarched(clamp(pixel + offsets[i], ivec2(0), lastPixel), colors[i], infos[i]);
+        if( infos[i].a < infos[nearest].a )
+            nearest = i;
+    }
+
+    if( historyValid )
+    {
+        for( int i = 0; i < 4; ++i )
+        {
+            if( Reproject(gl_FragCoord.xy, infos[i].a, history) )
+            {
+                out_color[0] = history;
+                out_color[1] = infos[i];
+                return;
+            }
+        }
+    }
+
+    // disocclusion: interpolates the neighbours on the same surface as the
+    // nearest one
+    vec4 color = vec4(0.0);
+    float totalWeight = 0.0;
+    for( int i = 0; i < 4; ++i )
+    {
+        float w = abs(infos[i].a - infos[nearest].a) <= infos[nearest].a * DEPTH_TOLERANCE ? 1.0 : 0.0;
+        color += colors[i] * w;
+        totalWeight += w;
+    }
+    out_color[0] = color / totalWeight;
+    out_color[1] = infos[nearest];
+}
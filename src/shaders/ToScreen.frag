@@ -2,9 +2,14 @@
 out vec4 out_Color;
 
 uniform sampler2D inputImage;
-uniform vec2 windowSize;
+layout(std140) uniform FrameData
+{
+    vec2 windowSize;
+    vec2 texelSize;
+    float frameTime;
+};
 
-vec2 texelCoord = vec2(gl_FragCoord.xy / windowSize);
+vec2 texelCoord = gl_FragCoord.xy * texelSize;
 
 void main (void)
 {
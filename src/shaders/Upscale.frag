@@ -0,0 +1,54 @@
+#version 330
+
+// Brings the output of a marcher rendered at a lower resolution back to
+// the full rendered region, see nodes/RayMarchingNode.cpp
+
+out vec4 out_color[2];
+
+uniform sampler2D inputImage;
+uniform sampler2D fragmentInfo;
+uniform float renderScale;
+
+layout(std140) uniform FrameData
+{
+    vec2 windowSize;
+    vec2 texelSize;
+    float frameTime;
+};
+
+// relative depth difference at which a sample stops contributing
+#define DEPTH_TOLERANCE 0.05
+
+void main(void)
+{
+    // position in the low resolution region, in texels
+    vec2 lowPos = gl_FragCoord.xy * renderScale - 0.5;
+    ivec2 base = ivec2(floor(lowPos));
+    vec2 f = lowPos - vec2(base);
+    ivec2 lastTexel = ivec2(ceil(windowSize * renderScale)) - 1;
+
+    ivec2 taps[4] = ivec2[]( ivec2(0,0), ivec2(1,0), ivec2(0,1), ivec2(1,1) );
+    float bilinear[4] = float[]( (1.0-f.x)*(1.0-f.y), f.x*(1.0-f.y), (1.0-f.x)*f.y, f.x*f.y );
+
+    // the nearest sample gives the reference depth and the fragment info,
+    // the normals and depths are never blended across a silhouette
+    int nearest = (f.x < 0.5 ? 0 : 1) + (f.y < 0.5 ? 0 : 2);
+    ivec2 nearestTexel = clamp(base + taps[nearest], ivec2(0), lastTexel);
+    vec4 info = texelFetch(fragmentInfo, nearestTexel, 0);
+    float refDepth = info.a;
+
+    vec4 color = vec4(0.0);
+    float totalWeight = 0.0;
+    for( int i = 0; i < 4; ++i )
+    {
+        ivec2 texel = clamp(base + taps[i], ivec2(0), lastTexel);
+        float depth = texelFetch(fragmentInfo, texel, 0).a;
+        float similarity = max(1.0 - abs(depth - refDepth) / (refDepth * DEPTH_TOLERANCE), 0.0);
+        float w = bilinear[i] * similarity + 1e-5;
+        color += texelFetch(inputImage, texel, 0) * w;
+        totalWeight += w;
+    }
+
+    out_color[0] = color / totalWeight;
+    out_color[1] = info;
+}
@@ -5,6 +5,9 @@
 
 using namespace std;
 
+int gl_checkpoint_line = 0;
+const char* gl_checkpoint_file = "";
+
 bool gl_check_error(int line, const char* comment)
 {
     GLuint err = glGetError();
@@ -16,3 +19,33 @@ bool gl_check_error(int line, const char* comment)
     return true;
 }
 
+#if GL_CHECK_MODE == GL_CHECK_DEBUG
+
+static void GLAPIENTRY gl_debug_callback( GLenum source, GLenum type, GLuint id, GLenum severity,
+                                          GLsizei length, const GLchar* message, const void* userParam )
+{
+    if( severity == GL_DEBUG_SEVERITY_NOTIFICATION )
+        return;
+    // the callback can run late, the checkpoint is the last one passed when it does
+    cout << "GL debug message " << id << " after " << gl_checkpoint_file
+         << ":" << gl_checkpoint_line << ": " << message << endl;
+}
+
+void gl_init_error_check()
+{
+    if( !GLEW_KHR_debug )
+    {
+        cout << "GL_KHR_debug is not supported, GL errors will not be reported" << endl;
+        return;
+    }
+    glEnable( GL_DEBUG_OUTPUT );
+    glDebugMessageCallback( gl_debug_callback, 0 );
+}
+
+#else
+
+void gl_init_error_check()
+{
+}
+
+#endif
@@ -2,10 +2,48 @@
 #ifndef UTILS_CHECKGLERROR_HPP
 #define UTILS_CHECKGLERROR_HPP
 
+// What CHECKERROR does, chosen at build time with -DGL_CHECK_MODE=...
+//  GL_CHECK_OFF:   nothing at all (default when NDEBUG is defined).
+//  GL_CHECK_SYNC:  glGetError at each checkpoint, which costs a round trip
+//                  to the driver (default otherwise).
+//  GL_CHECK_DEBUG: each checkpoint only records where it is; errors are
+//                  reported by a KHR_debug callback along with the last
+//                  checkpoint passed.
+#define GL_CHECK_OFF   0
+#define GL_CHECK_SYNC  1
+#define GL_CHECK_DEBUG 2
+
+#ifndef GL_CHECK_MODE
+#ifdef NDEBUG
+#define GL_CHECK_MODE GL_CHECK_OFF
+#else
+#define GL_CHECK_MODE GL_CHECK_SYNC
+#endif
+#endif
+
+#if GL_CHECK_MODE == GL_CHECK_SYNC
 #define CHECKERROR gl_check_error(__LINE__,__PRETTY_FUNCTION__);
+#elif GL_CHECK_MODE == GL_CHECK_DEBUG
+#define CHECKERROR gl_checkpoint(__LINE__,__FILE__);
+#else
+#define CHECKERROR
+#endif
 
 
 bool gl_check_error(int line, const char* comment = "");
 
+extern int gl_checkpoint_line;
+extern const char* gl_checkpoint_file;
+
+inline void gl_checkpoint(int line, const char* file)
+{
+    gl_checkpoint_line = line;
+    gl_checkpoint_file = file;
+}
+
+// Installs the debug callback in GL_CHECK_DEBUG mode, does nothing in the
+// other modes. Must be called once the context is current.
+void gl_init_error_check();
+
 
 #endif
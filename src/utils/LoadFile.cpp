@@ -3,6 +3,10 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 
 using namespace std;
 
@@ -32,6 +36,32 @@ bool LoadTextFile( const string& path, string& buffer )
 return true;
 }
 
+static void LoadTextFilesWorker( const vector<string>& paths, vector<string>& buffers,
+                                 atomic<unsigned int>& next, atomic<bool>& ok )
+{
+    for( unsigned int i = next++; i < paths.size(); i = next++ )
+    {
+        if( !LoadTextFile( paths[i], buffers[i] ) )
+            ok = false;
+    }
+}
+
+bool LoadTextFiles( const vector<string>& paths, vector<string>& buffers )
+{
+    buffers.assign( paths.size(), string() );
+    atomic<unsigned int> next( 0 );
+    atomic<bool> ok( true );
+
+    unsigned int nbThreads = std::min<unsigned int>( std::thread::hardware_concurrency(), paths.size() );
+    vector<thread> threads;
+    for( unsigned int i = 1; i < nbThreads; ++i )
+        threads.push_back( thread( LoadTextFilesWorker, cref(paths), ref(buffers), ref(next), ref(ok) ) );
+    LoadTextFilesWorker( paths, buffers, next, ok );
+
+    for( unsigned int i = 0; i < threads.size(); ++i )
+        threads[i].join();
+    return ok;
+}
 
 unsigned int LoadFile2( const char* path, char *& buffer )
 {
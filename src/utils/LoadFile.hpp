@@ -4,11 +4,16 @@
 #define UTILS_LOADFILE_HPP
 
 #include <string>
+#include <vector>
 
 namespace utils{
 
   bool LoadTextFile( const std::string& path, std::string& buffer );
 
+  // Loads the files on several threads; buffers[i] receives paths[i].
+  // False if any of them failed.
+  bool LoadTextFiles( const std::vector<std::string>& paths, std::vector<std::string>& buffers );
+
 }//namespace
 
 #endif
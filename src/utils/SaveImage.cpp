@@ -0,0 +1,44 @@
+#include "utils/SaveImage.hpp"
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+using namespace std;
+
+namespace utils{
+
+static unsigned char ToByte( float v )
+{
+    if( v <= 0.0f ) return 0;
+    if( v >= 1.0f ) return 255;
+    return (unsigned char)(v * 255.0f + 0.5f);
+}
+
+bool SavePPM( const string& path, int width, int height, const float* rgba )
+{
+    ofstream file( path.c_str(), ios::binary );
+    if( !file.is_open() )
+    {
+        cout << "Failed writing " << path << endl;
+        return false;
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    vector<unsigned char> row( width * 3 );
+    for( int y = height-1; y >= 0; --y )
+    {
+        const float* src = rgba + y * width * 4;
+        for( int x = 0; x < width; ++x )
+        {
+            row[x*3]   = ToByte( src[x*4] );
+            row[x*3+1] = ToByte( src[x*4+1] );
+            row[x*3+2] = ToByte( src[x*4+2] );
+        }
+        file.write( (const char*)&row[0], row.size() );
+    }
+
+    return file.good();
+}
+
+}//namespace
@@ -0,0 +1,16 @@
+#pragma once
+
+#ifndef UTILS_SAVEIMAGE_HPP
+#define UTILS_SAVEIMAGE_HPP
+
+#include <string>
+
+namespace utils{
+
+  // Writes a binary PPM from RGBA float pixels stored bottom row first (the
+  // layout of glReadPixels). Colors are clamped to [0,1].
+  bool SavePPM( const std::string& path, int width, int height, const float* rgba );
+
+}//namespace
+
+#endif